@@ -0,0 +1,522 @@
+#include "pandos_types.h"
+#include "pandos_const.h"
+#include "listx.h"
+#include "phase1/pcb.h"
+#include "phase1/asl.h"
+#include "phase1/slab.h"
+#include "utils.h"
+#include "host.h"
+
+/****************************************************************************
+ *
+ * Benchmark suite of the phase1 data structures (PCB pool, process queues,
+ * ASL, PID index) and of the kernel utilities, run natively on the host.
+ * Every benchmark is repeated for growing sizes to show how it scales.
+ *
+ ****************************************************************************/
+
+/* operations timed by each benchmark */
+#define OPS 1000000
+
+/*
+ * upper bound of the sizes used (PCBs live at the same time)
+ * it must fit in the initial pool plus the kernel frame pool
+ */
+#define NMAX 256
+
+HIDDEN pcb_t* procs[NMAX];
+HIDDEN int    keys[NMAX];
+
+HIDDEN list_head_t readyQ;
+HIDDEN list_head_t readyHighQ;
+
+HIDDEN state_t states[2];
+
+/* allocPcb initialization of this build (see PCB_LAZY_INIT) */
+#ifdef PCB_LAZY_INIT
+#define PCB_INIT_MODE "PCB_LAZY_INIT"
+#else
+#define PCB_INIT_MODE "default"
+#endif
+
+/* --- support functions --- */
+
+HIDDEN void allocProcs(unsigned int n)
+{
+    for (unsigned int i = 0; i < n; ++i) {
+        procs[i] = allocPcb();
+        procs[i]->p_pid = PID_MIN + i;
+        insertPid(procs[i]);
+    }
+}
+
+HIDDEN void freeProcs(unsigned int n)
+{
+    for (unsigned int i = 0; i < n; ++i) {
+        freePcb(procs[i]);
+    }
+}
+
+/*
+ * Baseline for findPcb: the linear scan of the ready queue
+ * and of every blocked queue, as findPcb used to do before the PID index
+ */
+HIDDEN pcb_t* scanPcb(pid_t pid)
+{
+    pcb_t* currentPcb;
+    semd_t* currentSemd;
+
+    list_for_each_entry(currentPcb, &readyQ, p_list) {
+        if (currentPcb->p_pid == pid) {
+            return currentPcb;
+        }
+    }
+
+    list_for_each_entry(currentSemd, getSemdHead(), s_link) {
+        list_for_each_entry(currentPcb, &currentSemd->s_procq, p_list) {
+            if (currentPcb->p_pid == pid) {
+                return currentPcb;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* --- benchmarks --- */
+
+/*
+ * n PCBs are alive, one at random is freed and allocated again
+ */
+HIDDEN void benchAllocFreeChurn(unsigned int n)
+{
+    allocProcs(n);
+
+    hostns_t start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        unsigned int k = hostRand() % n;
+        freePcb(procs[k]);
+        procs[k] = allocPcb();
+    }
+    hostReport("allocPcb+freePcb churn", n, hostNow() - start, OPS);
+
+    freeProcs(n);
+}
+
+/*
+ * n PCBs are allocated and then freed all together
+ * (the pools grow and shrink by whole frames on every round)
+ */
+HIDDEN void benchAllocFreeBurst(unsigned int n)
+{
+    unsigned int rounds = OPS / n;
+
+    hostns_t start = hostNow();
+    for (unsigned int r = 0; r < rounds; ++r) {
+        for (unsigned int i = 0; i < n; ++i) {
+            procs[i] = allocPcb();
+        }
+        for (unsigned int i = 0; i < n; ++i) {
+            freePcb(procs[i]);
+        }
+    }
+    hostReport("allocPcb+freePcb burst", n, hostNow() - start, (unsigned long long) rounds * n);
+}
+
+/*
+ * A parent with n children on the ready queue, one at random
+ * is terminated and a new one is created, as TERMPROCESS and
+ * CREATEPROCESS do on the phase1 structures (the cost of allocPcb
+ * initialization depends on PCB_LAZY_INIT, see PCB_INIT_MODE)
+ */
+HIDDEN void benchCreateTerminate(unsigned int n)
+{
+    pcb_t* parent = allocPcb();
+    pid_t nextPid = PID_MIN;
+
+    stateClear(&states[0]);
+
+    for (unsigned int i = 0; i < n; ++i) {
+        procs[i] = allocPcb();
+        procs[i]->p_pid = nextPid++;
+        insertPid(procs[i]);
+        insertChild(parent, procs[i]);
+        insertProcQ(&readyQ, procs[i]);
+    }
+
+    hostns_t start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        unsigned int k = hostRand() % n;
+
+        /* terminate */
+        outChild(procs[k]);
+        outProcQ(&readyQ, procs[k]);
+        freePcb(procs[k]);
+
+        /* create */
+        pcb_t* p = allocPcb();
+        p->p_pid = nextPid++;
+        p->p_prio = p->p_basePrio = PROCESS_PRIO_LOW;
+        p->p_supportStruct = NULL;
+        p->p_group = parent->p_group;
+        stateCopy(&p->p_s, &states[0]);
+        insertPid(p);
+        insertChild(parent, p);
+        insertProcQ(&readyQ, p);
+        procs[k] = p;
+    }
+    hostReport("create+terminate", n, hostNow() - start, OPS);
+
+    for (unsigned int i = 0; i < n; ++i) {
+        outChild(procs[i]);
+        outProcQ(&readyQ, procs[i]);
+    }
+    freeProcs(n);
+    freePcb(parent);
+}
+
+/*
+ * n processes blocked on n distinct semaphores,
+ * one at random is woken up and blocked again
+ */
+HIDDEN void benchBlockWakeup(unsigned int n)
+{
+    allocProcs(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        insertBlocked(&keys[i], procs[i]);
+    }
+
+    hostns_t start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        unsigned int k = hostRand() % n;
+        insertBlocked(&keys[k], removeBlocked(&keys[k]));
+    }
+    hostReport("removeBlocked+insertBlocked", n, hostNow() - start, OPS);
+
+    start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        unsigned int k = hostRand() % n;
+        insertBlocked(&keys[k], outBlocked(procs[k]));
+    }
+    hostReport("outBlocked+insertBlocked", n, hostNow() - start, OPS);
+
+    start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        headBlocked(&keys[hostRand() % n]);
+    }
+    hostReport("headBlocked", n, hostNow() - start, OPS);
+
+    for (unsigned int i = 0; i < n; ++i) {
+        removeBlocked(&keys[i]);
+    }
+    freeProcs(n);
+}
+
+/*
+ * n processes in a single ready queue, one at random is taken out and put back
+ */
+HIDDEN void benchOutProcQ(unsigned int n)
+{
+    allocProcs(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        insertProcQ(&readyQ, procs[i]);
+    }
+
+    hostns_t start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        pcb_t* p = procs[hostRand() % n];
+        insertProcQ(&readyQ, outProcQ(&readyQ, p));
+    }
+    hostReport("outProcQ+insertProcQ", n, hostNow() - start, OPS);
+
+    while (removeProcQ(&readyQ) != NULL)
+        ;
+    freeProcs(n);
+}
+
+/*
+ * n processes, half of them ready and half blocked on n/8 semaphores,
+ * lookup of a random pid
+ */
+HIDDEN void benchFindPcb(unsigned int n)
+{
+    allocProcs(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        if (i % 2 == 0) {
+            insertProcQ(&readyQ, procs[i]);
+        } else {
+            insertBlocked(&keys[i % (n / 8 + 1)], procs[i]);
+        }
+    }
+
+    hostns_t start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        scanPcb(PID_MIN + hostRand() % n);
+    }
+    hostReport("findPcb (queue scan)", n, hostNow() - start, OPS);
+
+    start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        findPid(PID_MIN + hostRand() % n);
+    }
+    hostReport("findPcb (PID index)", n, hostNow() - start, OPS);
+
+    for (unsigned int i = 0; i < n; ++i) {
+        if (i % 2 == 0) {
+            outProcQ(&readyQ, procs[i]);
+        } else {
+            outBlocked(procs[i]);
+        }
+    }
+    freeProcs(n);
+}
+
+/*
+ * ready queue of a woken process (for removeAllBlocked)
+ */
+HIDDEN list_head_t* readyQueueOf(pcb_t* p)
+{
+    return p->p_prio == PROCESS_PRIO_HIGH ? &readyHighQ : &readyQ;
+}
+
+/*
+ * n processes (the first half high priority) blocked on the same semaphore
+ * are all woken up onto two ready queues and blocked again:
+ * a removeBlocked per waiter against a single removeAllBlocked
+ */
+HIDDEN void benchBroadcast(unsigned int n)
+{
+    unsigned int rounds = OPS / n;
+    pcb_t* p;
+
+    allocProcs(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        procs[i]->p_prio = i < n / 2 ? PROCESS_PRIO_HIGH : PROCESS_PRIO_LOW;
+    }
+
+    hostns_t start = hostNow();
+    for (unsigned int r = 0; r < rounds; ++r) {
+        for (unsigned int i = 0; i < n; ++i) {
+            insertBlocked(&keys[0], procs[i]);
+        }
+        while ((p = removeBlocked(&keys[0])) != NULL) {
+            insertProcQ(readyQueueOf(p), p);
+        }
+        for (unsigned int i = 0; i < n; ++i) {
+            outProcQ(procs[i]->p_queue, procs[i]);
+        }
+    }
+    hostReport("removeBlocked loop", n, hostNow() - start, (unsigned long long) rounds * n);
+
+    start = hostNow();
+    for (unsigned int r = 0; r < rounds; ++r) {
+        for (unsigned int i = 0; i < n; ++i) {
+            insertBlocked(&keys[0], procs[i]);
+        }
+        removeAllBlocked(&keys[0], readyQueueOf);
+        for (unsigned int i = 0; i < n; ++i) {
+            outProcQ(procs[i]->p_queue, procs[i]);
+        }
+    }
+    hostReport("removeAllBlocked", n, hostNow() - start, (unsigned long long) rounds * n);
+
+    freeProcs(n);
+}
+
+/*
+ * Naive bit scans, shifting one bit at a time (reference for lsb/msb)
+ */
+HIDDEN unsigned int naiveLsb(unsigned int v)
+{
+    unsigned int pos = 0;
+
+    if (v != 0) {
+        while (!(v & 0x1)) {
+            v >>= 1;
+            ++pos;
+        }
+    }
+
+    return pos;
+}
+
+HIDDEN unsigned int naiveMsb(unsigned int v)
+{
+    unsigned int pos = 0;
+    while (v >>= 1) {
+        ++pos;
+    }
+
+    return pos;
+}
+
+/*
+ * Bit scan of masks with a single bit set among the lowest n
+ * (e.g. a pending interrupt line or device)
+ */
+HIDDEN void benchBitScan(unsigned int n)
+{
+    volatile unsigned int sink = 0;
+
+    hostns_t start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        sink += naiveLsb(1U << (hostRand() % n));
+    }
+    hostReport("lsb (bit by bit)", n, hostNow() - start, OPS);
+
+    start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        sink += lsb(1U << (hostRand() % n));
+    }
+    hostReport("lsb (de Bruijn)", n, hostNow() - start, OPS);
+
+    start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        sink += naiveMsb(1U << (hostRand() % n));
+    }
+    hostReport("msb (bit by bit)", n, hostNow() - start, OPS);
+
+    start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        sink += msb(1U << (hostRand() % n));
+    }
+    hostReport("msb (de Bruijn)", n, hostNow() - start, OPS);
+}
+
+/*
+ * Naive byte by byte copy (the old kernel memcpy, reference for the word copies)
+ */
+HIDDEN void* naiveMemcpy(void* dest, const void* src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        ((volatile unsigned char*) dest)[i] = ((const unsigned char*) src)[i];
+    }
+
+    return dest;
+}
+
+HIDDEN unsigned int pageBuf[2][PAGESIZE / WORDLEN];
+
+/*
+ * State save of a context switch (BIOS data page to PCB),
+ * byte by byte against stateCopy
+ */
+HIDDEN void benchStateSave()
+{
+    hostns_t start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        states[0].reg_v0 = i;
+        naiveMemcpy(&states[1], &states[0], sizeof(state_t));
+    }
+    hostReport("state save (byte memcpy)", sizeof(state_t), hostNow() - start, OPS);
+
+    start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        states[0].reg_v0 = i;
+        stateCopy(&states[1], &states[0]);
+    }
+    hostReport("state save (stateCopy)", sizeof(state_t), hostNow() - start, OPS);
+}
+
+/*
+ * Copy and fill of n bytes (word aligned buffers)
+ */
+HIDDEN void benchMemory(unsigned int n)
+{
+    unsigned int rounds = OPS / 64;
+
+    hostns_t start = hostNow();
+    for (unsigned int i = 0; i < rounds; ++i) {
+        pageBuf[0][0] = i;
+        naiveMemcpy(pageBuf[1], pageBuf[0], n);
+    }
+    hostReport("memcpy (byte by byte)", n, hostNow() - start, rounds);
+
+    start = hostNow();
+    for (unsigned int i = 0; i < rounds; ++i) {
+        pageBuf[0][0] = i;
+        memcpy(pageBuf[1], pageBuf[0], n);
+    }
+    hostReport("memcpy (words)", n, hostNow() - start, rounds);
+
+    start = hostNow();
+    for (unsigned int i = 0; i < rounds; ++i) {
+        memset(pageBuf[1], i, n);
+    }
+    hostReport("memset (words)", n, hostNow() - start, rounds);
+}
+
+/*
+ * Random number generation only (overhead included in every result above)
+ */
+HIDDEN void benchOverhead()
+{
+    volatile unsigned int sink = 0;
+
+    hostns_t start = hostNow();
+    for (unsigned int i = 0; i < OPS; ++i) {
+        sink += hostRand() % NMAX;
+    }
+    hostReport("hostRand (overhead)", 1, hostNow() - start, OPS);
+}
+
+int main()
+{
+    static const unsigned int sizes[] = { 4, 16, 64, NMAX };
+    const unsigned int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    initSlabs();
+    initPcbs();
+    initASL();
+    mkEmptyProcQ(&readyQ);
+    mkEmptyProcQ(&readyHighQ);
+
+    hostHeader("PCB pool", "benchmark");
+    for (unsigned int i = 0; i < nsizes; ++i) {
+        benchAllocFreeChurn(sizes[i]);
+    }
+    for (unsigned int i = 0; i < nsizes; ++i) {
+        benchAllocFreeBurst(sizes[i]);
+    }
+
+    hostHeader("Process create/terminate (allocPcb: " PCB_INIT_MODE ")", "benchmark");
+    for (unsigned int i = 0; i < nsizes; ++i) {
+        benchCreateTerminate(sizes[i]);
+    }
+
+    hostHeader("Process queues", "benchmark");
+    for (unsigned int i = 0; i < nsizes; ++i) {
+        benchOutProcQ(sizes[i]);
+    }
+
+    hostHeader("ASL (n distinct semaphores)", "benchmark");
+    for (unsigned int i = 0; i < nsizes; ++i) {
+        benchBlockWakeup(sizes[i]);
+    }
+
+    hostHeader("Broadcast wakeup (n waiters, per waiter)", "benchmark");
+    for (unsigned int i = 0; i < nsizes; ++i) {
+        benchBroadcast(sizes[i]);
+    }
+
+    hostHeader("PID lookup", "benchmark");
+    for (unsigned int i = 0; i < nsizes; ++i) {
+        benchFindPcb(sizes[i]);
+    }
+
+    hostHeader("Bit scan (one bit among the lowest n)", "benchmark");
+    benchBitScan(8);
+    benchBitScan(32);
+
+    hostHeader("Context switch (n = bytes)", "benchmark");
+    benchStateSave();
+
+    hostHeader("Memory primitives (n = bytes)", "benchmark");
+    benchMemory(64);
+    benchMemory(PAGESIZE);
+
+    hostHeader("Harness", "benchmark");
+    benchOverhead();
+
+    return 0;
+}
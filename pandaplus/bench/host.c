@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "host.h"
+#include "pandos_const.h"
+
+/* kernel frame pool (see KPOOLSTART in host/umps/const.h) */
+char hostKpool[KPOOLFRAMES * PAGESIZE] __attribute__((aligned(PAGESIZE)));
+
+/*
+ * Monotonic time in nanoseconds
+ */
+hostns_t hostNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (hostns_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * xorshift32, deterministic across runs
+ */
+unsigned int hostRand()
+{
+    static unsigned int state = 2463534242U;
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return state;
+}
+
+void hostHeader(const char* suite, const char* what)
+{
+    printf("\n%s\n%-28s %8s %12s\n", suite, what, "n", "ns/op");
+}
+
+void hostReport(const char* bench, unsigned int n, hostns_t elapsed, unsigned long long ops)
+{
+    printf("%-28s %8u %12.2f\n", bench, n, (double) elapsed / ops);
+}
@@ -0,0 +1,19 @@
+#ifndef HOST_H_INCLUDED
+#define HOST_H_INCLUDED
+
+/****************************************************************************
+ *
+ * Host services for the benchmarks (timing, randomness, reporting).
+ * They're kept in their own translation unit (host.c) since the kernel
+ * headers can't be mixed with the libc ones (e.g. size_t).
+ *
+ ****************************************************************************/
+
+typedef unsigned long long hostns_t;
+
+hostns_t     hostNow();
+unsigned int hostRand();
+void         hostHeader(const char* suite, const char* what);
+void         hostReport(const char* bench, unsigned int n, hostns_t elapsed, unsigned long long ops);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef UMPS_ARCH_H
+#define UMPS_ARCH_H
+
+/****************************************************************************
+ *
+ * Host stub of the uMPS3 machine description.
+ * Shared by the host builds (bench/, sim/): same values as the real header,
+ * limited to the definitions the kernel uses.
+ *
+ ****************************************************************************/
+
+#define WS 4
+
+/* Interrupt lines */
+#define N_INTERRUPT_LINES 8
+#define N_IL              N_INTERRUPT_LINES
+
+#define IL_IPI      0
+#define IL_CPUTIMER 1
+#define IL_TIMER    2
+#define IL_DISK     3
+#define IL_FLASH    4
+#define IL_ETHERNET 5
+#define IL_PRINTER  6
+#define IL_TERMINAL 7
+
+/* Devices */
+#define DEV_IL_START   3
+#define N_EXT_IL       5
+#define N_DEV_PER_IL   8
+#define DEV_REG_SIZE_W 4
+#define DEV_REG_SIZE   (DEV_REG_SIZE_W * WS)
+
+#define EXT_IL_INDEX(il) ((il) - DEV_IL_START)
+
+/* Bus register area */
+#define BUS_REG_RAM_BASE   0x10000000
+#define BUS_REG_RAM_SIZE   0x10000004
+#define BUS_REG_TOD_HI     0x10000018
+#define BUS_REG_TOD_LO     0x1000001c
+#define BUS_REG_TIMER      0x10000020
+#define BUS_REG_TIME_SCALE 0x10000024
+
+/* Installed devices bitmap and pending interrupts bitmap */
+#define CDEV_BITMAP_BASE       0x10000040
+#define CDEV_BITMAP_ADDR(line) (CDEV_BITMAP_BASE + ((line) - DEV_IL_START) * WS)
+
+/* Device register area */
+#define DEV_REG_START           0x10000054
+#define DEV_REG_ADDR(line, dev) (DEV_REG_START + ((line) - DEV_IL_START) * N_DEV_PER_IL * DEV_REG_SIZE + (dev) * DEV_REG_SIZE)
+
+/* Terminal device register fields */
+#define RECVSTATUS  0
+#define RECVCOMMAND 1
+#define TRANSTATUS  2
+#define TRANCOMMAND 3
+
+/* Interrupt routing table and CPU control registers */
+#define IRT_BASE             0x10000300
+#define IRT_ENTRY(line, dev) (IRT_BASE + (((line) - 2) * N_DEV_PER_IL + (dev)) * WS)
+#define IRT_ENTRY_POLICY_BIT 28
+#define IRT_ENTRY_DEST_MASK  0xffff
+
+#define CPUCTL_BASE 0x10000400
+#define CPUCTL_TPR  (CPUCTL_BASE + 0x8)
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef UMPS_CONST_H
+#define UMPS_CONST_H
+
+/****************************************************************************
+ *
+ * Host stub of the uMPS3 constants.
+ * Shared by the host builds (bench/, sim/): same values as the real header,
+ * limited to the definitions the kernel uses.
+ *
+ ****************************************************************************/
+
+#include "arch.h"
+
+#define HIDDEN static
+#define TRUE   1
+#define FALSE  0
+
+#ifndef NULL
+#define NULL ((void *) 0)
+#endif
+
+/* Device interrupts */
+#define DEVINTNUM 5
+#define DEVPERINT 8
+
+#define DISKINT  3
+#define FLASHINT 4
+#define NETWINT  5
+#define PRNTINT  6
+#define TERMINT  7
+
+/* Device status codes */
+#define UNINSTALLED 0
+#define READY       1
+#define BUSY        3
+
+/* Device commands */
+#define RESET 0
+#define ACK   1
+
+/*
+ * on the host there's no physical RAM to carve frames from:
+ * the kernel frame pool lives in a static array (defined by each host build)
+ */
+extern char hostKpool[];
+#define KPOOLSTART hostKpool
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef UMPS_CP0_H
+#define UMPS_CP0_H
+
+/****************************************************************************
+ *
+ * Host stub of the uMPS3 CP0 definitions.
+ * Shared by the host builds (bench/, sim/): same values as the real header,
+ * limited to the definitions the kernel uses.
+ *
+ ****************************************************************************/
+
+/* Status register */
+#define STATUS_IEc 0x00000001
+#define STATUS_IEp 0x00000004
+#define STATUS_KUp 0x00000008
+#define STATUS_IM_MASK 0x0000ff00
+#define STATUS_TE  0x08000000
+
+/* Cause register */
+#define CAUSE_EXCCODE_MASK 0x0000007c
+#define CAUSE_EXCCODE_BIT  2
+#define CAUSE_GET_EXCCODE(x) (((x) & CAUSE_EXCCODE_MASK) >> CAUSE_EXCCODE_BIT)
+#define CAUSE_IP_MASK      0x0000ff00
+#define CAUSE_IP_BIT(line) (8 + (line))
+#define CAUSE_IP(line)     (1U << CAUSE_IP_BIT(line))
+
+/* Exception codes */
+#define EXC_INT  0
+#define EXC_MOD  1
+#define EXC_TLBL 2
+#define EXC_TLBS 3
+#define EXC_ADEL 4
+#define EXC_ADES 5
+#define EXC_IBE  6
+#define EXC_DBE  7
+#define EXC_SYS  8
+#define EXC_BP   9
+#define EXC_RI   10
+#define EXC_CPU  11
+#define EXC_OV   12
+
+/* EntryHi / EntryLo */
+#define ENTRYHI_VPN_BIT   12
+#define ENTRYHI_ASID_MASK 0x00000fc0
+#define ENTRYHI_ASID_BIT  6
+#define ENTRYLO_PFN_MASK  0xfffff000
+#define ENTRYLO_PFN_BIT   12
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef UMPS_LIBUMPS_H
+#define UMPS_LIBUMPS_H
+
+/****************************************************************************
+ *
+ * Host stub of the uMPS3 support library.
+ * Shared by the host builds; the functions are provided by the host machine
+ * emulation (see sim/machine.c).
+ *
+ ****************************************************************************/
+
+/* CP0 registers */
+unsigned int getSTATUS();
+unsigned int setSTATUS(unsigned int status);
+unsigned int getCAUSE();
+unsigned int setCAUSE(unsigned int cause);
+unsigned int getTIMER();
+unsigned int setTIMER(unsigned int timer);
+unsigned int getPRID();
+unsigned int getENTRYHI();
+unsigned int setENTRYHI(unsigned int entryHi);
+unsigned int setENTRYLO(unsigned int entryLo);
+
+/* TLB */
+void TLBWR();
+void TLBWI();
+void TLBP();
+void TLBCLR();
+
+/* BIOS services */
+void LDST(void* state) __attribute__((noreturn));
+void LDCXT(unsigned int stackPtr, unsigned int status, unsigned int pc) __attribute__((noreturn));
+void WAIT();
+void HALT() __attribute__((noreturn));
+void PANIC() __attribute__((noreturn));
+unsigned int SYSCALL(unsigned int number, unsigned int arg1, unsigned int arg2, unsigned int arg3);
+
+/* Multiprocessor support */
+unsigned int CAS(volatile unsigned int* atomic, unsigned int ver, unsigned int new);
+void INITCPU(unsigned int cpuid, void* start_state);
+
+/* Bus timers (through the memory mapped bus registers) */
+#define STCK(T) ((T) = ((*((cpu_t*) TODLOADDR)) / (*((cpu_t*) TIMESCALEADDR))))
+#define LDIT(T) ((*((cpu_t*) INTERVALTMR)) = (T) * (*((cpu_t*) TIMESCALEADDR)))
+
+#endif
@@ -0,0 +1,483 @@
+#define _GNU_SOURCE
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <umps/libumps.h>
+#include <umps/cp0.h>
+#include <umps/arch.h>
+#include "pandos_const.h"
+
+#include "machine.h"
+
+typedef signed int cpu_t;
+
+/* RAM pages mapped at RAMSTART (syscall arguments must fit in 32 bit) */
+#define RAM_PAGES 4
+
+/*
+ * command register content while an interrupt is raised,
+ * so that only a new write of ACK from the kernel acknowledges it
+ * (queued requests share the register with the completed one)
+ */
+#define NOCOMMAND 0xFFFFFFFF
+
+/* register at the given bus/device physical address */
+#define REG(addr) (*((volatile unsigned int*) (uintptr_t) (addr)))
+
+/* device state, only flash/disk/printer-like devices are modeled */
+typedef struct request_t {
+    uint64_t          latency;
+    unsigned int      tag;
+    struct request_t* next;
+} request_t;
+
+typedef struct device_t {
+    request_t* head;    /* queued requests, the head is being served */
+    request_t* tail;
+    uint64_t   doneAt;  /* completion time of the head request */
+    int        pending; /* completed, interrupt not yet ACKed */
+} device_t;
+
+extern void exceptionHandler();
+
+/* kernel frame pool (see KPOOLSTART in host/umps/const.h) */
+char hostKpool[KPOOLFRAMES * PAGESIZE] __attribute__((aligned(PAGESIZE)));
+
+state_t            machineState;
+unsigned long long machineKernelEntries;
+unsigned long long machineInterrupts;
+unsigned long long machineKernelCycles;
+
+HIDDEN jmp_buf      kernelExit;
+HIDDEN int          cpuMode;
+HIDDEN unsigned int cpuStatus;
+HIDDEN uint64_t     now;
+HIDDEN uint64_t     kernelCost;
+HIDDEN uint64_t     kernelStart;
+
+/* processor local timer */
+HIDDEN unsigned int pltValue;
+HIDDEN int          pltPending;
+
+/* interval timer (value last seen in its bus register) */
+HIDDEN unsigned int itShadow;
+HIDDEN int          itPending;
+
+HIDDEN device_t devices[N_EXT_IL][N_DEV_PER_IL];
+
+HIDDEN void (*ioDone)(unsigned int tag, uint64_t when);
+HIDDEN void (*clockTick)(uint64_t when);
+
+/* --- support functions --- */
+
+HIDDEN void mapPage(uintptr_t addr, size_t size)
+{
+    void* p = mmap((void*) addr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (p != (void*) addr) {
+        fprintf(stderr, "machine: can't map physical address 0x%08lx\n", (unsigned long) addr);
+        exit(1);
+    }
+}
+
+/*
+ * Countdown of a 32 bit timer register by dt
+ * returns 1 if the timer reached 0 in the meantime
+ */
+HIDDEN int countdown(unsigned int* value, uint64_t dt)
+{
+    int fired = *value != 0 && dt >= *value;
+    *value = (unsigned int) (*value - dt);
+
+    return fired;
+}
+
+/*
+ * A write to the interval timer register from the kernel (LDIT) is an ACK
+ */
+HIDDEN void syncIntervalTimer()
+{
+    if (REG(INTERVALTMR) != itShadow) {
+        itShadow = REG(INTERVALTMR);
+        itPending = 0;
+    }
+}
+
+HIDDEN void startRequest(device_t* d)
+{
+    if (d->head != NULL && !d->pending) {
+        d->doneAt = now + d->head->latency;
+    }
+}
+
+/*
+ * A device with a pending interrupt whose command register holds ACK
+ * has been acknowledged: serve its next request
+ */
+HIDDEN void syncDevices()
+{
+    for (unsigned int line = DEV_IL_START; line < N_IL; ++line) {
+        for (unsigned int dev = 0; dev < N_DEV_PER_IL; ++dev) {
+            device_t* d = &devices[EXT_IL_INDEX(line)][dev];
+            dtpreg_t* reg = (dtpreg_t*) (uintptr_t) DEV_REG_ADDR(line, dev);
+
+            if (d->pending && reg->command == ACK) {
+                request_t* done = d->head;
+                d->head = done->next;
+                if (d->head == NULL) {
+                    d->tail = NULL;
+                }
+                free(done);
+
+                d->pending = 0;
+                REG(CDEV_BITMAP_ADDR(line)) &= ~(1U << dev);
+                startRequest(d);
+            }
+        }
+    }
+}
+
+HIDDEN unsigned int pendingLines()
+{
+    unsigned int ip = 0;
+
+    if (pltPending) {
+        ip |= CAUSE_IP(IL_CPUTIMER);
+    }
+    if (itPending) {
+        ip |= CAUSE_IP(IL_TIMER);
+    }
+    for (unsigned int line = DEV_IL_START; line < N_IL; ++line) {
+        if (REG(CDEV_BITMAP_ADDR(line)) != 0) {
+            ip |= CAUSE_IP(line);
+        }
+    }
+
+    return ip;
+}
+
+/*
+ * Host time stamp counter (nanoseconds where there is none),
+ * to measure the kernel code itself, which runs natively
+ */
+HIDDEN uint64_t hostCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/*
+ * Run kernel code until it gives control back
+ */
+HIDDEN int enterKernel(void (*entry)())
+{
+    kernelStart = hostCycles();
+
+    if (setjmp(kernelExit) == 0) {
+        entry();
+        fprintf(stderr, "machine: kernel code returned\n");
+        abort();
+    }
+
+    /* from the exception to LDST (or WAIT), the machine model is left out */
+    machineKernelCycles += hostCycles() - kernelStart;
+
+    syncIntervalTimer();
+    syncDevices();
+
+    return cpuMode;
+}
+
+/* --- machine interface --- */
+
+void machineInit(uint64_t cost)
+{
+    mapPage(BIOSDATAPAGE, PAGESIZE);
+    mapPage(BUS_REG_RAM_BASE, PAGESIZE);
+    mapPage(RAMSTART, RAM_PAGES * PAGESIZE);
+
+    REG(RAMBASEADDR) = RAMSTART;
+    REG(RAMBASESIZE) = RAM_PAGES * PAGESIZE;
+    REG(TIMESCALEADDR) = 1;
+    REG(TODLOADDR) = 0;
+
+    itShadow = REG(INTERVALTMR) = 0xFFFFFFFF;
+    pltValue = 0xFFFFFFFF;
+    kernelCost = cost;
+}
+
+int machineBoot(void (*kernelMain)())
+{
+    cpuStatus = 0;
+    int mode = enterKernel(kernelMain);
+
+    /* the boot is not a kernel entry */
+    machineKernelCycles = 0;
+
+    return mode;
+}
+
+/*
+ * Take an exception on behalf of the running process (or of the idle processor)
+ * the processor state is saved in the BIOS data page as the BIOS would do
+ */
+int machineException(unsigned int excCode)
+{
+    state_t* biosState = (state_t*) (uintptr_t) PROCESSORSTATE0;
+
+    ++machineKernelEntries;
+    if (excCode == EXC_INT) {
+        ++machineInterrupts;
+    }
+
+    memcpy(biosState, &machineState, sizeof(state_t));
+    biosState->cause = (excCode << CAUSE_EXCCODE_BIT) | pendingLines();
+
+    machineAdvance(kernelCost);
+
+    return enterKernel(exceptionHandler);
+}
+
+uint64_t machineNow()
+{
+    return now;
+}
+
+/*
+ * Absolute time of the next timer expiration or device completion
+ */
+uint64_t machineNextEvent()
+{
+    uint64_t next = UINT64_MAX;
+
+    syncIntervalTimer();
+
+    if (pltValue != 0 && now + pltValue < next) {
+        next = now + pltValue;
+    }
+    if (itShadow != 0 && now + itShadow < next) {
+        next = now + itShadow;
+    }
+    for (unsigned int il = 0; il < N_EXT_IL; ++il) {
+        for (unsigned int dev = 0; dev < N_DEV_PER_IL; ++dev) {
+            device_t* d = &devices[il][dev];
+            if (d->head != NULL && !d->pending && d->doneAt < next) {
+                next = d->doneAt;
+            }
+        }
+    }
+
+    return next;
+}
+
+void machineAdvance(uint64_t dt)
+{
+    syncIntervalTimer();
+
+    now += dt;
+    REG(TODLOADDR) = (unsigned int) now;
+
+    if (countdown(&pltValue, dt)) {
+        pltPending = 1;
+    }
+
+    unsigned int it = itShadow;
+    if (countdown(&it, dt)) {
+        itPending = 1;
+        if (clockTick != NULL) {
+            clockTick(now - (dt - itShadow));
+        }
+    }
+    itShadow = REG(INTERVALTMR) = it;
+
+    for (unsigned int line = DEV_IL_START; line < N_IL; ++line) {
+        for (unsigned int dev = 0; dev < N_DEV_PER_IL; ++dev) {
+            device_t* d = &devices[EXT_IL_INDEX(line)][dev];
+            dtpreg_t* reg = (dtpreg_t*) (uintptr_t) DEV_REG_ADDR(line, dev);
+
+            if (d->head != NULL && !d->pending && d->doneAt <= now) {
+                d->pending = 1;
+                reg->status = READY;
+                reg->command = NOCOMMAND;
+                REG(CDEV_BITMAP_ADDR(line)) |= 1U << dev;
+                if (ioDone != NULL) {
+                    ioDone(d->head->tag, d->doneAt);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Is there an interrupt the processor would take right now?
+ */
+int machinePending()
+{
+    unsigned int status = cpuMode == CPU_RUNNING ? machineState.status : cpuStatus;
+    unsigned int ip = pendingLines() & status & IMON;
+
+    if (!(status & TEBITON)) {
+        ip &= ~CAUSE_IP(IL_CPUTIMER);
+    }
+
+    return (status & (IEPON | IECON)) && ip != 0;
+}
+
+void machineDoIo(unsigned int line, unsigned int dev, uint64_t latency, unsigned int tag)
+{
+    device_t* d = &devices[EXT_IL_INDEX(line)][dev];
+    request_t* r = malloc(sizeof(request_t));
+
+    r->latency = latency;
+    r->tag = tag;
+    r->next = NULL;
+
+    if (d->tail == NULL) {
+        d->head = d->tail = r;
+        startRequest(d);
+    } else {
+        d->tail->next = r;
+        d->tail = r;
+    }
+}
+
+void machineOnIoDone(void (*fn)(unsigned int tag, uint64_t when))
+{
+    ioDone = fn;
+}
+
+void machineOnClockTick(void (*fn)(uint64_t when))
+{
+    clockTick = fn;
+}
+
+void* machineRam(unsigned int offset)
+{
+    return (void*) (uintptr_t) (RAMSTART + offset);
+}
+
+unsigned int machineRamAddr(unsigned int offset)
+{
+    return RAMSTART + offset;
+}
+
+/* --- libumps --- */
+
+unsigned int getSTATUS()
+{
+    return cpuStatus;
+}
+
+unsigned int setSTATUS(unsigned int status)
+{
+    return cpuStatus = status;
+}
+
+unsigned int getCAUSE()
+{
+    state_t* biosState = (state_t*) (uintptr_t) PROCESSORSTATE0;
+    return (biosState->cause & CAUSE_EXCCODE_MASK) | pendingLines();
+}
+
+unsigned int setCAUSE(unsigned int cause)
+{
+    return cause;
+}
+
+unsigned int getTIMER()
+{
+    return pltValue;
+}
+
+unsigned int setTIMER(unsigned int timer)
+{
+    pltPending = 0;
+    return pltValue = timer;
+}
+
+unsigned int getPRID()
+{
+    return 0;
+}
+
+unsigned int getENTRYHI()
+{
+    return 0;
+}
+
+unsigned int setENTRYHI(unsigned int entryHi)
+{
+    return entryHi;
+}
+
+unsigned int setENTRYLO(unsigned int entryLo)
+{
+    return entryLo;
+}
+
+void TLBWR() {}
+void TLBWI() {}
+void TLBP() {}
+void TLBCLR() {}
+
+void LDST(void* state)
+{
+    memcpy(&machineState, state, sizeof(state_t));
+    cpuMode = CPU_RUNNING;
+    longjmp(kernelExit, 1);
+}
+
+void LDCXT(unsigned int stackPtr, unsigned int status, unsigned int pc)
+{
+    machineState.reg_sp = stackPtr;
+    machineState.status = status;
+    machineState.pc_epc = pc;
+    cpuMode = CPU_RUNNING;
+    longjmp(kernelExit, 1);
+}
+
+void WAIT()
+{
+    cpuMode = CPU_WAITING;
+    longjmp(kernelExit, 1);
+}
+
+void HALT()
+{
+    cpuMode = CPU_HALTED;
+    longjmp(kernelExit, 1);
+}
+
+void PANIC()
+{
+    cpuMode = CPU_PANICKED;
+    longjmp(kernelExit, 1);
+}
+
+unsigned int SYSCALL(unsigned int number, unsigned int arg1, unsigned int arg2, unsigned int arg3)
+{
+    fprintf(stderr, "machine: SYSCALL from kernel code is not supported on the host\n");
+    abort();
+}
+
+unsigned int CAS(volatile unsigned int* atomic, unsigned int ver, unsigned int new)
+{
+    if (*atomic != ver) {
+        return 0;
+    }
+
+    *atomic = new;
+    return 1;
+}
+
+void INITCPU(unsigned int cpuid, void* start_state) {}
@@ -0,0 +1,47 @@
+#ifndef SIM_MACHINE_H_INCLUDED
+#define SIM_MACHINE_H_INCLUDED
+
+/****************************************************************************
+ *
+ * Host emulation of the parts of the uMPS3 machine the kernel talks to:
+ * BIOS data page, bus registers (TOD, interval timer), processor local timer,
+ * devices with a configurable latency and the libumps BIOS services.
+ * Kernel code runs natively; it gives control back to the simulator
+ * through LDST, WAIT, HALT or PANIC.
+ *
+ * Time is in microseconds (the time scale is 1).
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <umps/types.h>
+
+/* what the processor is doing once the kernel gives control back */
+#define CPU_RUNNING  0 /* a process state has been loaded (machineState) */
+#define CPU_WAITING  1 /* idle in WAIT, until the next interrupt */
+#define CPU_HALTED   2
+#define CPU_PANICKED 3
+
+/* state of the running process (valid with CPU_RUNNING) */
+extern state_t machineState;
+
+/* counters */
+extern unsigned long long machineKernelEntries;
+extern unsigned long long machineInterrupts;
+/* host cycles spent in kernel code, over all the kernel entries */
+extern unsigned long long machineKernelCycles;
+
+void         machineInit(uint64_t kernelCost);
+int          machineBoot(void (*kernelMain)());
+int          machineException(unsigned int excCode);
+uint64_t     machineNow();
+uint64_t     machineNextEvent();
+void         machineAdvance(uint64_t dt);
+int          machinePending();
+void         machineDoIo(unsigned int line, unsigned int dev, uint64_t latency, unsigned int tag);
+void         machineOnIoDone(void (*fn)(unsigned int tag, uint64_t when));
+void         machineOnClockTick(void (*fn)(uint64_t when));
+void*        machineRam(unsigned int offset);
+unsigned int machineRamAddr(unsigned int offset);
+
+#endif
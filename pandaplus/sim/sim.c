@@ -0,0 +1,769 @@
+/****************************************************************************
+ *
+ * Trace driven scheduler simulator
+ * the real phase2 kernel (scheduler, interrupt and syscall handlers, phase1
+ * queues) runs on top of the host machine emulation of machine.c, while the
+ * processes are replayed from a trace: CPU bursts, DOIO waits, CLOCKWAIT and SLEEP waits
+ *
+ * usage: sim [-k cost] [-s seed] [-n] (-g nproc | trace)
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <umps/cp0.h>
+#include "pandos_const.h"
+
+#include "machine.h"
+
+/* process program: op index kept in pc_epc (one word per op), id in s0 */
+#define OP_PC(i)    ((i) * WORDLEN)
+#define OP_INDEX(s) ((s).pc_epc / WORDLEN)
+#define PROC_ID(s)  ((s).reg_s0)
+/* remaining time of the current CPU burst, saved with the process state */
+#define BURST(s)    ((s).reg_s1)
+
+/* ops of the trace */
+#define OP_CPU    'c' /* CPU burst (us) */
+#define OP_DOIO   'd' /* DOIO on the process device (latency in us) */
+#define OP_CLOCK  'w' /* CLOCKWAIT */
+#define OP_YIELD  'y' /* YIELD */
+#define OP_LOCK   'l' /* P(mutex arg) */
+#define OP_UNLOCK 'u' /* V(mutex arg) */
+#define OP_RT     'r' /* SETREALTIME(period arg, budget arg2) */
+#define OP_SIGNAL 'v' /* V(event arg) */
+#define OP_AWAIT  'a' /* P(event arg) */
+#define OP_SIGWAIT 'x' /* SEMSIGNALWAIT(event arg, event arg2) */
+#define OP_GROUP  'g' /* SETGROUP(group arg) */
+#define OP_QUOTA  'q' /* SETQUOTA(own group, quota arg, period arg2) */
+#define OP_SLEEP  's' /* SLEEP (us) */
+/* ops of the simulator protocol */
+#define OP_CREATE 'C' /* init: create process arg */
+#define OP_P      'P' /* P(masterSem) */
+#define OP_V      'V' /* V(masterSem) */
+#define OP_TERM   'T' /* TERMPROCESS(0) */
+
+/* RAM layout: process state template and master semaphore */
+#define TEMPLATE_OFFSET 0
+#define MASTERSEM_OFFSET 0x400
+#define MUTEX_OFFSET     0x800
+#define MUTEXES          64
+#define EVENT_OFFSET     0xA00
+#define EVENTS           64
+
+/* devices used by DOIO (the ethernet line is skipped) */
+HIDDEN const unsigned int ioLines[] = { DISKINT, FLASHINT, PRNTINT };
+#define IO_LINES (sizeof(ioLines) / sizeof(ioLines[0]))
+
+/* waiting states of a process */
+#define WAIT_NONE  0
+#define WAIT_IO    1
+#define WAIT_CLOCK 2
+#define WAIT_SLEEP 3
+
+#define NOTREADY UINT64_MAX
+
+typedef struct op_t {
+    char         kind;
+    unsigned int arg, arg2;
+} op_t;
+
+typedef struct proc_t {
+    int          prio;
+    op_t*        ops;
+    unsigned int nops;
+    unsigned int ioLine, ioDev;
+
+    int          waiting;
+    uint64_t     readySince;
+    uint64_t     created, finished;
+
+    /* real-time period (0 if none) and release time of the current job */
+    unsigned int rtPeriod;
+    uint64_t     jobStart;
+
+    /* start of the current wait on an event */
+    uint64_t     eventSince;
+    uint64_t     sleepUntil;
+
+    /* process group (as set by the trace) */
+    unsigned int group;
+} proc_t;
+
+typedef struct samples_t {
+    uint64_t*    v;
+    unsigned int n, size;
+} samples_t;
+
+/* kernel entry point (phase2/initial.c is built with -Dmain=kernelMain) */
+extern void kernelMain();
+/* kernel counters (phase2/variables.h, phase2/groups.h) */
+extern unsigned int deadlineMisses;
+extern unsigned int interruptEntries, interruptsServiced;
+extern unsigned int workItems, workMaxDepth;
+extern int          groupUsage(unsigned int group);
+extern unsigned int groupThrottles(unsigned int group);
+
+HIDDEN proc_t*      procs;
+HIDDEN unsigned int nprocs;
+
+/* metrics */
+HIDDEN samples_t          turnaround;
+HIDDEN samples_t          response[2];
+HIDDEN samples_t          eventWait;
+HIDDEN samples_t          sleepLate;
+HIDDEN unsigned long long contextSwitches;
+HIDDEN uint64_t           busyTime, idleTime;
+/* real-time jobs (a job ends with a CLOCKWAIT), the late ones, rejected SETREALTIME */
+HIDDEN unsigned int       rtJobs, rtLate, rtRejected;
+/* the trace uses process groups */
+HIDDEN int                groupsUsed;
+
+/* replay the real-time processes as normal ones (SETREALTIME is skipped) */
+HIDDEN int noRealTime;
+
+/*
+ * Never executed: the simulator interprets the process programs itself,
+ * the symbols are needed to link phase2/initial.c
+ */
+void test() {}
+void uTLB_RefillHandler() {}
+
+/* --- support functions --- */
+
+HIDDEN void* xrealloc(void* p, size_t size)
+{
+    p = realloc(p, size);
+    if (p == NULL) {
+        fprintf(stderr, "sim: out of memory\n");
+        exit(1);
+    }
+
+    return p;
+}
+
+HIDDEN void addOp(proc_t* p, char kind, unsigned int arg)
+{
+    p->ops = xrealloc(p->ops, (p->nops + 1) * sizeof(op_t));
+    p->ops[p->nops].kind = kind;
+    p->ops[p->nops].arg = arg;
+    p->ops[p->nops].arg2 = 0;
+    ++p->nops;
+}
+
+HIDDEN proc_t* addProc(int prio)
+{
+    procs = xrealloc(procs, (nprocs + 1) * sizeof(proc_t));
+    proc_t* p = &procs[nprocs];
+
+    memset(p, 0, sizeof(proc_t));
+    p->prio = prio;
+    p->readySince = NOTREADY;
+    p->eventSince = NOTREADY;
+    p->sleepUntil = NOTREADY;
+    p->ioLine = ioLines[nprocs % IO_LINES];
+    p->ioDev = (nprocs / IO_LINES) % DEVPERINT;
+    ++nprocs;
+
+    return p;
+}
+
+HIDDEN void addSample(samples_t* s, uint64_t v)
+{
+    if (s->n == s->size) {
+        s->size = s->size == 0 ? 64 : s->size * 2;
+        s->v = xrealloc(s->v, s->size * sizeof(uint64_t));
+    }
+
+    s->v[s->n++] = v;
+}
+
+HIDDEN int cmpSample(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+HIDDEN uint64_t percentile(samples_t* s, unsigned int pct)
+{
+    if (s->n == 0) {
+        return 0;
+    }
+
+    return s->v[(uint64_t) (s->n - 1) * pct / 100];
+}
+
+HIDDEN double average(samples_t* s)
+{
+    double sum = 0;
+
+    for (unsigned int i = 0; i < s->n; ++i) {
+        sum += s->v[i];
+    }
+
+    return s->n != 0 ? sum / s->n : 0;
+}
+
+/* --- workload --- */
+
+/*
+ * Trace format: one process per line, "<prio> op op ..."
+ * prio is high/low (or 1/0), ops are c<us>, d<us>, w, y,
+ * l<n> and u<n> (lock/unlock of mutex n, a binary semaphore P/V with SEM_MUTEX),
+ * r<period>:<budget> (SETREALTIME, the process jobs end with its CLOCKWAITs),
+ * v<n>, a<n> and x<n>:<m> (signal/await of event n, signal n and await m at once:
+ * events are semaphores starting from 0, e.g. for ping-pongs),
+ * g<n> (join group n) and q<quota>:<period> (CPU bandwidth quota of the process group)
+ * text after a # is a comment
+ */
+HIDDEN void loadTrace(const char* path)
+{
+    FILE* f = fopen(path, "r");
+    char line[4096];
+    unsigned int lineNo = 0;
+
+    if (f == NULL) {
+        perror(path);
+        exit(1);
+    }
+
+    /* process 0 is init */
+    addProc(PROCESS_PRIO_LOW);
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        ++lineNo;
+        char* hash = strchr(line, '#');
+        if (hash != NULL) {
+            *hash = '\0';
+        }
+
+        char* tok = strtok(line, " \t\r\n");
+        if (tok == NULL) {
+            continue;
+        }
+
+        int prio;
+        if (strcmp(tok, "high") == 0 || strcmp(tok, "1") == 0) {
+            prio = PROCESS_PRIO_HIGH;
+        } else if (strcmp(tok, "low") == 0 || strcmp(tok, "0") == 0) {
+            prio = PROCESS_PRIO_LOW;
+        } else {
+            fprintf(stderr, "%s:%u: bad priority '%s'\n", path, lineNo, tok);
+            exit(1);
+        }
+
+        proc_t* p = addProc(prio);
+        while ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+            char kind = tok[0];
+            if ((kind != OP_CPU && kind != OP_DOIO && kind != OP_CLOCK && kind != OP_YIELD &&
+                 kind != OP_LOCK && kind != OP_UNLOCK && kind != OP_RT &&
+                 kind != OP_SIGNAL && kind != OP_AWAIT && kind != OP_SIGWAIT &&
+                 kind != OP_GROUP && kind != OP_QUOTA && kind != OP_SLEEP) ||
+                (tok[1] != '\0' && !isdigit((unsigned char) tok[1]))) {
+                fprintf(stderr, "%s:%u: bad op '%s'\n", path, lineNo, tok);
+                exit(1);
+            }
+
+            char* end;
+            unsigned int arg = strtoul(tok + 1, &end, 10);
+            if ((kind == OP_LOCK || kind == OP_UNLOCK) && arg >= MUTEXES) {
+                fprintf(stderr, "%s:%u: mutex %u out of range\n", path, lineNo, arg);
+                exit(1);
+            }
+            if ((kind == OP_RT || kind == OP_SIGWAIT || kind == OP_QUOTA) && *end != ':') {
+                fprintf(stderr, "%s:%u: bad op '%s' (%c<arg>:<arg>)\n", path, lineNo, tok, kind);
+                exit(1);
+            }
+            unsigned int arg2 = *end == ':' ? strtoul(end + 1, NULL, 10) : 0;
+            if ((kind == OP_SIGNAL || kind == OP_AWAIT || kind == OP_SIGWAIT) &&
+                (arg >= EVENTS || arg2 >= EVENTS)) {
+                fprintf(stderr, "%s:%u: event out of range\n", path, lineNo);
+                exit(1);
+            }
+            groupsUsed |= kind == OP_GROUP || kind == OP_QUOTA;
+            addOp(p, kind, arg);
+            p->ops[p->nops - 1].arg2 = arg2;
+        }
+    }
+
+    fclose(f);
+}
+
+/* xorshift, the workload must not depend on the host libc */
+HIDDEN unsigned int rngState;
+
+HIDDEN unsigned int rng(unsigned int lo, unsigned int hi)
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+
+    return lo + rngState % (hi - lo + 1);
+}
+
+/*
+ * Synthetic workload
+ * a quarter of interactive processes (high priority, short bursts and I/O),
+ * the others are batch processes (low priority, long bursts, some I/O and clock waits)
+ */
+HIDDEN void generateTrace(unsigned int n, unsigned int seed)
+{
+    rngState = seed != 0 ? seed : 1;
+
+    addProc(PROCESS_PRIO_LOW);
+
+    for (unsigned int i = 0; i < n; ++i) {
+        if (rng(0, 3) == 0) {
+            proc_t* p = addProc(PROCESS_PRIO_HIGH);
+            for (unsigned int j = rng(10, 40); j > 0; --j) {
+                addOp(p, OP_CPU, rng(50, 500));
+                addOp(p, OP_DOIO, rng(500, 5000));
+            }
+        } else {
+            proc_t* p = addProc(PROCESS_PRIO_LOW);
+            for (unsigned int j = rng(5, 20); j > 0; --j) {
+                addOp(p, OP_CPU, rng(2000, 30000));
+                switch (rng(0, 3)) {
+                    case 0:
+                        addOp(p, OP_DOIO, rng(1000, 10000));
+                        break;
+                    case 1:
+                        addOp(p, OP_CLOCK, 0);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Completes the programs with the simulator protocol
+ * init creates everyone and waits on the master semaphore,
+ * every process signals it before terminating
+ */
+HIDDEN void finalizePrograms()
+{
+    for (unsigned int i = 1; i < nprocs; ++i) {
+        addOp(&procs[0], OP_CREATE, i);
+        addOp(&procs[i], OP_V, 0);
+        addOp(&procs[i], OP_TERM, 0);
+    }
+    for (unsigned int i = 1; i < nprocs; ++i) {
+        addOp(&procs[0], OP_P, 0);
+    }
+    addOp(&procs[0], OP_TERM, 0);
+}
+
+/* --- machine callbacks --- */
+
+HIDDEN void ioDone(unsigned int tag, uint64_t when)
+{
+    procs[tag].waiting = WAIT_NONE;
+    procs[tag].readySince = when;
+}
+
+HIDDEN void clockTick(uint64_t when)
+{
+    for (unsigned int i = 0; i < nprocs; ++i) {
+        if (procs[i].waiting == WAIT_CLOCK) {
+            procs[i].waiting = WAIT_NONE;
+            procs[i].readySince = when;
+            procs[i].jobStart = when;
+        }
+    }
+}
+
+/* --- simulation --- */
+
+/*
+ * Issue the syscall of the current op of the running process
+ */
+HIDDEN int issue(proc_t* p, op_t* op)
+{
+    state_t* s = &machineState;
+
+    s->reg_a1 = s->reg_a2 = s->reg_a3 = 0;
+
+    switch (op->kind) {
+        case OP_DOIO: {
+            s->reg_a0 = DOIO;
+            s->reg_a1 = DEV_REG_ADDR(p->ioLine, p->ioDev) + WORDLEN; /* command */
+            s->reg_a2 = FLASHREAD;
+            p->waiting = WAIT_IO;
+            machineDoIo(p->ioLine, p->ioDev, op->arg, p - procs);
+            break;
+        }
+        case OP_CLOCK:
+            s->reg_a0 = CLOCKWAIT;
+            p->waiting = WAIT_CLOCK;
+            if (p->rtPeriod != 0) {
+                ++rtJobs;
+                rtLate += machineNow() - p->jobStart > p->rtPeriod;
+            }
+            break;
+        case OP_RT:
+            s->reg_a0 = SETREALTIME;
+            s->reg_a1 = op->arg;
+            s->reg_a2 = op->arg2;
+            p->rtPeriod = op->arg;
+            p->jobStart = machineNow();
+            break;
+        case OP_YIELD:
+            s->reg_a0 = YIELD;
+            break;
+        case OP_SLEEP:
+            s->reg_a0 = SLEEP;
+            s->reg_a1 = op->arg;
+            p->waiting = WAIT_SLEEP;
+            p->sleepUntil = machineNow() + op->arg;
+            break;
+        case OP_GROUP:
+            s->reg_a0 = SETGROUP;
+            s->reg_a1 = op->arg;
+            p->group = op->arg;
+            break;
+        case OP_QUOTA:
+            s->reg_a0 = SETQUOTA;
+            s->reg_a1 = p->group;
+            s->reg_a2 = op->arg;
+            s->reg_a3 = op->arg2;
+            break;
+        case OP_LOCK:
+            s->reg_a0 = PASSEREN;
+            s->reg_a1 = machineRamAddr(MUTEX_OFFSET + op->arg * WORDLEN);
+            s->reg_a2 = SEM_MUTEX;
+            break;
+        case OP_UNLOCK:
+            s->reg_a0 = VERHOGEN;
+            s->reg_a1 = machineRamAddr(MUTEX_OFFSET + op->arg * WORDLEN);
+            s->reg_a2 = SEM_MUTEX;
+            break;
+        case OP_SIGNAL:
+            s->reg_a0 = VERHOGEN;
+            s->reg_a1 = machineRamAddr(EVENT_OFFSET + op->arg * WORDLEN);
+            break;
+        case OP_AWAIT:
+            s->reg_a0 = PASSEREN;
+            s->reg_a1 = machineRamAddr(EVENT_OFFSET + op->arg * WORDLEN);
+            p->eventSince = machineNow();
+            break;
+        case OP_SIGWAIT:
+            s->reg_a0 = SEMSIGNALWAIT;
+            s->reg_a1 = machineRamAddr(EVENT_OFFSET + op->arg * WORDLEN);
+            s->reg_a2 = machineRamAddr(EVENT_OFFSET + op->arg2 * WORDLEN);
+            p->eventSince = machineNow();
+            break;
+        case OP_CREATE: {
+            state_t* t = machineRam(TEMPLATE_OFFSET);
+            memset(t, 0, sizeof(state_t));
+            t->status = TEBITON | IMON | IEPON;
+            t->pc_epc = OP_PC(0);
+            t->reg_sp = machineRamAddr(MASTERSEM_OFFSET - WORDLEN);
+            PROC_ID(*t) = op->arg;
+
+            s->reg_a0 = CREATEPROCESS;
+            s->reg_a1 = machineRamAddr(TEMPLATE_OFFSET);
+            s->reg_a2 = procs[op->arg].prio;
+            procs[op->arg].created = machineNow();
+            procs[op->arg].readySince = machineNow();
+            break;
+        }
+        case OP_P:
+            s->reg_a0 = PASSEREN;
+            s->reg_a1 = machineRamAddr(MASTERSEM_OFFSET);
+            break;
+        case OP_V:
+            s->reg_a0 = VERHOGEN;
+            s->reg_a1 = machineRamAddr(MASTERSEM_OFFSET);
+            break;
+        case OP_TERM:
+            s->reg_a0 = TERMPROCESS;
+            p->finished = machineNow();
+            if (p != procs) {
+                addSample(&turnaround, p->finished - p->created);
+            }
+            break;
+        default:
+            break;
+    }
+
+    int mode = machineException(EXC_SYS);
+
+    /* the kernel pools are bounded (KPOOLFRAMES): the workload can't be replayed */
+    if (op->kind == OP_CREATE && mode == CPU_RUNNING && (int) machineState.reg_v0 == -1) {
+        fprintf(stderr, "sim: CREATEPROCESS failed for process %u (out of PCBs)\n", op->arg);
+        exit(1);
+    }
+    if (op->kind == OP_RT && mode == CPU_RUNNING && (int) machineState.reg_v0 == -1) {
+        ++rtRejected;
+        p->rtPeriod = 0;
+    }
+    if ((op->kind == OP_GROUP || op->kind == OP_QUOTA) && mode == CPU_RUNNING && (int) machineState.reg_v0 == -1) {
+        fprintf(stderr, "sim: %s failed for process %ld\n", op->kind == OP_GROUP ? "SETGROUP" : "SETQUOTA", (long) (p - procs));
+        exit(1);
+    }
+
+    return mode;
+}
+
+HIDDEN int run()
+{
+    int mode = machineBoot(kernelMain);
+    proc_t* current = NULL;
+
+    /* the first process (init) starts from test(), its program from the first op */
+    if (mode == CPU_RUNNING && machineState.pc_epc == (unsigned int) (uintptr_t) test) {
+        machineState.pc_epc = OP_PC(0);
+    }
+
+    for (;;) {
+        if (mode == CPU_HALTED) {
+            return 0;
+        } else if (mode == CPU_PANICKED) {
+            fprintf(stderr, "sim: kernel PANIC at %llu us\n", (unsigned long long) machineNow());
+            return 1;
+        }
+
+        proc_t* next = mode == CPU_RUNNING ? &procs[PROC_ID(machineState)] : NULL;
+
+        /* the wait on an event is over once the process runs again */
+        if (next != NULL && next->eventSince != NOTREADY) {
+            addSample(&eventWait, machineNow() - next->eventSince);
+            next->eventSince = NOTREADY;
+        }
+
+        /* a sleeper is ready from its wake time, it runs again that much late */
+        if (next != NULL && next->sleepUntil != NOTREADY) {
+            addSample(&sleepLate, machineNow() - next->sleepUntil);
+            next->waiting = WAIT_NONE;
+            next->readySince = next->sleepUntil;
+            next->sleepUntil = NOTREADY;
+        }
+
+        if (next != current) {
+            ++contextSwitches;
+
+            /* a process descheduled without waiting is ready from now on */
+            if (current != NULL && current->waiting == WAIT_NONE && current->readySince == NOTREADY) {
+                current->readySince = machineNow();
+            }
+            current = next;
+        }
+
+        if (mode == CPU_WAITING) {
+            /* an interrupt left pending (e.g. behind a higher priority line) is taken right away */
+            if (machinePending()) {
+                mode = machineException(EXC_INT);
+                continue;
+            }
+
+            uint64_t event = machineNextEvent();
+            if (event == UINT64_MAX) {
+                fprintf(stderr, "sim: processor waiting forever at %llu us\n", (unsigned long long) machineNow());
+                return 1;
+            }
+
+            idleTime += event - machineNow();
+            machineAdvance(event - machineNow());
+            if (machinePending()) {
+                mode = machineException(EXC_INT);
+            }
+            continue;
+        }
+
+        /* the process has been dispatched */
+        if (current->readySince != NOTREADY) {
+            op_t* op = &current->ops[OP_INDEX(machineState)];
+            /* response time is sampled while the process runs its trace */
+            if (current != procs && op->kind != OP_V && op->kind != OP_TERM) {
+                addSample(&response[current->prio], machineNow() - current->readySince);
+            }
+            current->readySince = NOTREADY;
+        }
+
+        if (machinePending()) {
+            mode = machineException(EXC_INT);
+            continue;
+        }
+
+        op_t* op = &current->ops[OP_INDEX(machineState)];
+
+        if (op->kind == OP_RT && noRealTime) {
+            /* jobs are still measured against the period */
+            current->rtPeriod = op->arg;
+            current->jobStart = machineNow();
+            machineState.pc_epc += WORDLEN;
+        } else if (op->kind == OP_CPU) {
+            if (BURST(machineState) == 0) {
+                BURST(machineState) = op->arg;
+            }
+
+            /* run up to the end of the burst or the next machine event */
+            uint64_t dt = BURST(machineState);
+            uint64_t event = machineNextEvent();
+            if (event - machineNow() < dt) {
+                dt = event - machineNow();
+            }
+
+            busyTime += dt;
+            machineAdvance(dt);
+            BURST(machineState) -= dt;
+            if (BURST(machineState) == 0) {
+                machineState.pc_epc += WORDLEN;
+            }
+        } else {
+            mode = issue(current, op);
+        }
+    }
+}
+
+HIDDEN void report()
+{
+    uint64_t makespan = machineNow();
+    const char* prioName[2] = { "low", "high" };
+
+    qsort(turnaround.v, turnaround.n, sizeof(uint64_t), cmpSample);
+
+    printf("processes          %u\n", nprocs - 1);
+    printf("makespan           %llu us\n", (unsigned long long) makespan);
+    printf("throughput         %.2f proc/s\n", makespan != 0 ? (nprocs - 1) * 1e6 / makespan : 0);
+    printf("cpu utilization    %.1f %% (idle %.1f %%)\n",
+        makespan != 0 ? 100.0 * busyTime / makespan : 0,
+        makespan != 0 ? 100.0 * idleTime / makespan : 0);
+    printf("context switches   %llu\n", contextSwitches);
+    printf("kernel entries     %llu (%llu interrupts)\n", machineKernelEntries, machineInterrupts);
+    printf("kernel path        %.0f host cycles per entry (exception to LDST)\n",
+        machineKernelEntries != 0 ? (double) machineKernelCycles / machineKernelEntries : 0);
+    printf("interrupts served  %u in %u entries (%u entries saved)\n",
+        interruptsServiced, interruptEntries, interruptsServiced - interruptEntries);
+    printf("deferred work      %u items (at most %u queued at once)\n", workItems, workMaxDepth);
+    printf("turnaround         avg %.0f  p50 %llu  p95 %llu  max %llu us\n",
+        average(&turnaround),
+        (unsigned long long) percentile(&turnaround, 50),
+        (unsigned long long) percentile(&turnaround, 95),
+        (unsigned long long) percentile(&turnaround, 100));
+
+    samples_t all = { 0 };
+    for (int prio = PROCESS_PRIO_HIGH; prio >= PROCESS_PRIO_LOW; --prio) {
+        samples_t* s = &response[prio];
+        for (unsigned int i = 0; i < s->n; ++i) {
+            addSample(&all, s->v[i]);
+        }
+    }
+
+    qsort(all.v, all.n, sizeof(uint64_t), cmpSample);
+    printf("response (all)     avg %.0f  p50 %llu  p90 %llu  p99 %llu  max %llu us  (%u samples)\n",
+        average(&all),
+        (unsigned long long) percentile(&all, 50),
+        (unsigned long long) percentile(&all, 90),
+        (unsigned long long) percentile(&all, 99),
+        (unsigned long long) percentile(&all, 100),
+        all.n);
+
+    for (int prio = PROCESS_PRIO_HIGH; prio >= PROCESS_PRIO_LOW; --prio) {
+        samples_t* s = &response[prio];
+        qsort(s->v, s->n, sizeof(uint64_t), cmpSample);
+        printf("response (%-4s)    avg %.0f  p50 %llu  p90 %llu  p99 %llu  max %llu us  (%u samples)\n",
+            prioName[prio],
+            average(s),
+            (unsigned long long) percentile(s, 50),
+            (unsigned long long) percentile(s, 90),
+            (unsigned long long) percentile(s, 99),
+            (unsigned long long) percentile(s, 100),
+            s->n);
+    }
+
+    free(all.v);
+
+    if (eventWait.n != 0) {
+        qsort(eventWait.v, eventWait.n, sizeof(uint64_t), cmpSample);
+        printf("event wait         avg %.0f  p50 %llu  p99 %llu  max %llu us  (%u samples)\n",
+            average(&eventWait),
+            (unsigned long long) percentile(&eventWait, 50),
+            (unsigned long long) percentile(&eventWait, 99),
+            (unsigned long long) percentile(&eventWait, 100),
+            eventWait.n);
+    }
+
+    if (sleepLate.n != 0) {
+        qsort(sleepLate.v, sleepLate.n, sizeof(uint64_t), cmpSample);
+        printf("sleep lateness     avg %.0f  p50 %llu  p99 %llu  max %llu us  (%u samples)\n",
+            average(&sleepLate),
+            (unsigned long long) percentile(&sleepLate, 50),
+            (unsigned long long) percentile(&sleepLate, 99),
+            (unsigned long long) percentile(&sleepLate, 100),
+            sleepLate.n);
+    }
+
+    if (rtJobs != 0 || rtRejected != 0) {
+        printf("real-time jobs     %u  late %u (kernel deadline misses %u)  rejected %u\n",
+            rtJobs, rtLate, deadlineMisses, rtRejected);
+    }
+
+    if (groupsUsed) {
+        for (unsigned int g = 0; g < MAXGROUPS; ++g) {
+            if (groupUsage(g) > 0) {
+                printf("group %u            cpu %d us (%.1f %%)  throttled %u times\n",
+                    g, groupUsage(g), makespan != 0 ? 100.0 * groupUsage(g) / makespan : 0, groupThrottles(g));
+            }
+        }
+    }
+}
+
+HIDDEN void usage()
+{
+    fprintf(stderr, "usage: sim [-k kernel_cost_us] [-s seed] [-n] (-g nproc | trace)\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t kernelCost = 5;
+    unsigned int seed = 1;
+    unsigned int generate = 0;
+    const char* trace = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            kernelCost = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            noRealTime = 1;
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            generate = strtoul(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && trace == NULL) {
+            trace = argv[i];
+        } else {
+            usage();
+        }
+    }
+
+    if ((generate == 0) == (trace == NULL)) {
+        usage();
+    }
+
+    if (trace != NULL) {
+        loadTrace(trace);
+    } else {
+        generateTrace(generate, seed);
+    }
+    finalizePrograms();
+
+    machineInit(kernelCost);
+    for (unsigned int i = 0; i < MUTEXES; ++i) {
+        ((int*) machineRam(MUTEX_OFFSET))[i] = 1;
+    }
+    machineOnIoDone(ioDone);
+    machineOnClockTick(clockTick);
+
+    int ret = run();
+    report();
+
+    return ret;
+}
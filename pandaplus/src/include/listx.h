@@ -156,6 +156,26 @@ static inline void list_del(struct list_head *entry) {
     __list_del(entry->prev, entry->next);
 }
 
+/*
+    Sposta in coda alla lista head gli elementi compresi tra first e last
+    (inclusi), togliendoli dalla lista in cui sono contenuti.
+    Il costo non dipende dal numero di elementi spostati.
+
+    first: primo elemento da spostare
+    last: ultimo elemento da spostare (first stesso o uno dei successivi)
+    head: lista in cui inserire gli elementi
+
+    return: void
+*/
+static inline void list_move_range_tail(struct list_head *first, struct list_head *last, struct list_head *head) {
+    __list_del(first->prev, last->next);
+
+    first->prev = head->prev;
+    head->prev->next = first;
+    last->next = head;
+    head->prev = last;
+}
+
 /*
     Funzione che controlla se la lista e' arrivata alla fine
 
@@ -48,11 +48,24 @@
 #define GETSUPPORTPTR -8
 #define GETPROCESSID  -9
 #define YIELD         -10
+#define SEMBROADCAST  -11
+#define SETREALTIME   -12
+#define SEMSIGNALWAIT -13
+#define SETGROUP      -14
+#define SETQUOTA      -15
+#define GETGROUPUSAGE -16
+#define SLEEP         -17
 
 
 #define PROCESS_PRIO_LOW  0
 #define PROCESS_PRIO_HIGH 1
 
+/*
+ * PASSEREN/VERHOGEN flag (second argument):
+ * the semaphore is used as a mutex, its owner inherits the priority of the waiters
+ */
+#define SEM_MUTEX 1
+
 
 /* Status register constants */
 #define ALLOFF      0x00000000
@@ -148,7 +161,6 @@
 #define DEVICECNT  (DEVINTNUM * DEVPERINT)
 #define MAXSTRLENG 128
 
-#define DELAYASID    (UPROCMAX + 1)
 #define KUSEG3SECTNO 0
 
 #define VMDISK        0
@@ -177,7 +189,118 @@
 #define PID_MIN 2
 #define PID_MAX 0x7FFF
 
-#define PROCESSORSTATE0 BIOSDATAPAGE
+/* PID index hash table initial size (number of buckets, log2; see phase1/hash.c) */
+#define PID_HASH_BITS 5
+#define PID_HASH_SIZE (1 << PID_HASH_BITS)
+
+/*
+ * Symmetric multiprocessing
+ * NCPU must match "num-processors" in umps3.json (at most 16);
+ * with a single processor the per-processor bookkeeping compiles away
+ */
+#ifndef NCPU
+#define NCPU 1
+#endif
+
+#if NCPU > 1
+#define CPUID() getPRID()
+#else
+#define CPUID() 0
+#endif
+
+/*
+ * with IRQ_CPU the last processor is dedicated to the interrupts:
+ * all the device and interval timer interrupts are routed to it and it runs no process
+ * (so it needs NCPU > 1, e.g. NCPU 2 for one processor running processes)
+ */
+#ifdef IRQ_CPU
+#if NCPU < 2
+#error "IRQ_CPU needs at least two processors (NCPU)"
+#endif
+#define IRQCPU (NCPU - 1)
+#else
+#define IRQCPU NCPU /* none */
+#endif
+
+/* exception state saved by the BIOS and pass up vector of each processor */
+#define PROCESSORSTATE(cpu)   (BIOSDATAPAGE + (cpu) * STATESIZE)
+#define PROCESSORSTATE0       PROCESSORSTATE(0)
+#define CPUPASSUPVECTOR(cpu)  (PASSUPVECTOR + (cpu) * 4 * WORDLEN)
+
+/* kernel stack of each processor, the secondary ones right after the kernel frame pool */
+#define CPUSTACK(cpu) ((cpu) == 0 ? (memaddr) KERNELSTACK : (memaddr) (KPOOLSTART) + (KPOOLFRAMES + (cpu)) * PAGESIZE)
+
+/* an idle processor looks for ready processes (made ready by the others) every IDLE_POLL microseconds */
+#define IDLE_POLL TIMESLICE
+
+/*
+ * Kernel frame pool, used to grow the phase1 PCB/SEMD pools at runtime
+ * it starts right after the swap pool (which ends at FRAMEPOOLSTART)
+ * and leaves the top of RAM to the stack of the first process
+ * (host builds, see bench/, place it somewhere else)
+ */
+#ifndef KPOOLSTART
+#define KPOOLSTART  FRAMEPOOLSTART
+#endif
+#define KPOOLFRAMES 32
+
+/*
+ * Multi-level feedback queue scheduler
+ * level 0 is the top one, the quantum doubles at each level
+ * (TIMESLICE is the quantum of the top level of low priority processes)
+ * high priority processes start from level 0, low priority ones from level 1
+ */
+#define MLFQ_LEVELS            4
+#define MLFQ_QUANTUM(level)    ((TIMESLICE / 2) << (level))
+#define MLFQ_TOP_LEVEL(prio)   ((prio) == PROCESS_PRIO_HIGH ? 0 : 1)
+/* every process goes back to its top level every MLFQ_AGING_PERIOD microseconds */
+#define MLFQ_AGING_PERIOD      (10 * PSECOND)
+
+/*
+ * Fair-share scheduler (built with -DSCHED_FAIR)
+ * the virtual runtime grows as the used cpu time divided by the weight
+ * (relative to a low priority process), every runnable process runs once
+ * every FAIR_LATENCY microseconds, for a quantum proportional to its weight
+ * but never shorter than FAIR_MIN_GRANULARITY
+ */
+#define FAIR_WEIGHT_LOW        1024
+#define FAIR_WEIGHT_HIGH       3072
+#define FAIR_WEIGHT(prio)      ((prio) == PROCESS_PRIO_HIGH ? FAIR_WEIGHT_HIGH : FAIR_WEIGHT_LOW)
+#define FAIR_LATENCY           20000
+#define FAIR_MIN_GRANULARITY   2000
+/* how much virtual runtime a process can be behind the others when it gets ready */
+#define FAIR_WAKEUP_CREDIT     (FAIR_LATENCY / 2)
+
+/*
+ * Real-time (EDF) class
+ * the utilization (budget/period, in thousandths) of all the real-time processes
+ * can't exceed EDF_MAX_UTIL, so that the other classes are never starved;
+ * periods are bounded by EDF_MAX_PERIOD (us) so that budget * 1000 fits in a word
+ */
+#define EDF_MAX_UTIL           900
+#define EDF_MAX_PERIOD         4000000
+
+/*
+ * Process groups (CPU bandwidth quotas)
+ * group 0 is the default one and has no quota; periods are bounded
+ * by GROUP_MAX_PERIOD (us) so that the refill time fits the TOD comparisons
+ */
+#define MAXGROUPS              8
+#define GROUP_MAX_PERIOD       4000000
+
+/*
+ * Resizable hash tables (ASL and PID index, see phase1/hash.c)
+ * the number of buckets doubles when the average load exceeds HASH_MAXLOAD
+ * and halves when it drops below 1/4; the initial (and minimum) size is static,
+ * the larger ones are taken from the kernel frame pool
+ */
+#define HASH_MAXLOAD 1
+/* 2^32 / golden ratio, for multiplicative hashing */
+#define HASH_GOLDEN  0x9E3779B9U
+
+/* ASL hash table initial size (number of buckets, log2) */
+#define SEMD_HASH_BITS 5
+#define SEMD_HASH_SIZE (1 << SEMD_HASH_BITS)
 
 /* Support level SYS calls */
 #define GETTOD        1
@@ -185,6 +308,7 @@
 #define WRITEPRINTER  3
 #define WRITETERMINAL 4
 #define READTERMINAL  5
+#define DELAY         6
 
 #define VPNSTARTADDR KUSEG
 #define VPNSTACK USERSTACKTOP - PAGESIZE
@@ -194,5 +318,6 @@
 #define ENTRYHI_SET_ASID(reg, x) reg = (reg & ~ENTRYHI_ASID_MASK) | ((x) << ENTRYHI_ASID_BIT)
 #define ENTRYHI_GET_VPN2(x) (((x) & ENTRYHI_VPN_MASK2) == VPNSTACK ? USERPGTBLSIZE-1 : ((x) - VPNSTARTADDR) >> ENTRYHI_VPN_BIT)
 #define ENTRYLO_SET_PFN(reg, x) reg = (reg & ~ENTRYLO_PFN_MASK) | (FLASHPOOLSTART + ((x) << ENTRYLO_PFN_BIT))
+#define ENTRYLO_GET_PFN(reg) ((((reg) & ENTRYLO_PFN_MASK) - FLASHPOOLSTART) >> ENTRYLO_PFN_BIT)
 
 #endif
@@ -28,7 +28,11 @@ typedef struct pteEntry_t {
 } pteEntry_t;
 
 
-/* Support level context */
+/*
+ * Support level context
+ * the handler is entered with a0 = support struct, a1 = exception type
+ * (PGFAULTEXCEPT / GENERALEXCEPT)
+ */
 typedef struct context_t {
     unsigned int stackPtr;
     unsigned int status;
@@ -47,31 +51,90 @@ typedef struct support_t {
 } support_t;
 
 
-/* process table entry type */
+/* kernel timer (see phase2/timers.c) */
+typedef struct ktimer_t {
+    /* timer queue, ordered by expiry */
+    list_head_t t_link;
+    /* expiry time (TOD, in microseconds) */
+    unsigned int t_expiry;
+    /* called on expiry, once the timer has left the queue */
+    void (*t_handler)(struct ktimer_t* t);
+} ktimer_t;
+
+
+/*
+ * process table entry type
+ * the fields read on every queue operation and dispatch come first,
+ * so they share the same cache lines, followed by the fields of the
+ * scheduling classes, while the large processor state
+ * (only touched on context switches) is kept last
+ */
 typedef struct pcb_t {
     /* process queue  */
     list_head_t p_list;
+    /* head of the process queue p_list is currently linked in (NULL if none) */
+    list_head_t* p_queue;
+
+    /* Indicator of priority; 0 - low, 1 - high (effective, may be inherited) */
+    int p_prio;
+    /* priority assigned on creation, p_prio falls back to it */
+    int p_basePrio;
+
+    /* Pointer to the semaphore the process is currently blocked on */
+    int* p_semAdd;
+
+    /* cpu time used by proc */
+    cpu_t p_time;
+
+    /* process id */
+    int p_pid;
+
+    /* Pointer to the support struct */
+    support_t *p_supportStruct;
+
+    /* MLFQ level (0 is the top one) and aging epoch it was last set in */
+    int          p_level;
+    unsigned int p_agingEpoch;
+    /* fair-share scheduler: virtual runtime and links in the ready tree */
+    unsigned int  p_vruntime;
+    struct pcb_t* p_treeLeft;
+    struct pcb_t* p_treeRight;
+    struct pcb_t* p_treeUp;
+    unsigned int  p_treeRank;
+    /*
+     * real-time (EDF) class: period and budget (us, period 0 if not real-time),
+     * absolute deadline and budget left of the current job, job completed flag
+     */
+    unsigned int p_rtPeriod;
+    unsigned int p_rtBudget;
+    unsigned int p_rtDeadline;
+    unsigned int p_rtLeft;
+    int          p_rtDone;
+    /* process group (CPU bandwidth quota), inherited from the creator */
+    unsigned int p_group;
 
     /* process tree fields */
     struct pcb_t* p_parent; /* ptr to parent */
     list_head_t   p_child;  /* children list */
     list_head_t   p_sib;    /* sibling list  */
 
-    /* process status information */
-    state_t p_s;    /* processor state */
-    cpu_t   p_time; /* cpu time used by proc */
+    /* PID index hash bucket list */
+    list_head_t p_pidLink;
 
-    /* Pointer to the semaphore the process is currently blocked on */
-    int* p_semAdd;
+    /* semaphores (used as mutexes) currently owned by the process */
+    list_head_t p_owned;
 
-    /* Pointer to the support struct */
-    support_t *p_supportStruct;
+    /* one-shot timer of a process sleeping in a SLEEP (links to NULL if not armed) */
+    ktimer_t p_sleepTimer;
 
-    /* Indicator of priority; 0 - low, 1 - high */
-    int p_prio;
+    /*
+     * killed while running on another processor: the PCB is freed
+     * when that processor gets back to the kernel (see exceptionHandler)
+     */
+    int p_dying;
 
-    /* process id */
-    int p_pid;
+    /* process status information */
+    state_t p_s; /* processor state */
 } pcb_t, *pcb_PTR;
 
 
@@ -84,9 +147,76 @@ typedef struct semd_t {
 
     /* Semaphore list */
     list_head_t s_link;
+    /* Semaphore hash bucket list */
+    list_head_t s_hash;
+
+    /* process holding the semaphore as a mutex (NULL if none) */
+    struct pcb_t* s_owner;
+    /* list of the semaphores owned by s_owner */
+    list_head_t   s_ownedLink;
 } semd_t, *semd_PTR;
 
 
+/* deferred work item, the bottom half of an interrupt (see phase2/work.c) */
+typedef struct work_t {
+    /* work queue, FIFO */
+    list_head_t w_link;
+    /* called by workRun, once the item has left the queue */
+    void (*w_handler)(struct work_t* w);
+    /* I/O completion: semaphore of the device and its status (before the ACK) */
+    sem_t*      w_sem;
+    devregf_t   w_status;
+} work_t;
+
+
+/* process group, sharing a CPU bandwidth quota (see phase2/groups.c) */
+typedef struct group_t {
+    /* cpu time (us) the group can use every period (us), quota 0 = no limit */
+    unsigned int g_quota;
+    unsigned int g_period;
+    /* cpu time used in the current period */
+    unsigned int g_used;
+    /* quota used up: the ready processes of the group are parked up to the refill */
+    int          g_throttled;
+    list_head_t  g_parked;
+    /* end of the current period */
+    ktimer_t     g_refill;
+    /* usage counters: total cpu time (us), times the group has been throttled */
+    unsigned int g_usage;
+    unsigned int g_throttles;
+} group_t;
+
+
+/* object cache (pool of PCBs or SEMDs) grown by whole frames */
+typedef struct slabCache_t {
+    list_head_t* c_free;       /* list of the free objects of the cache */
+    size_t       c_objSize;    /* size of an object */
+    size_t       c_linkOffset; /* offset of the list_head linking the free objects */
+    unsigned int c_freeCount;  /* number of free objects */
+} slabCache_t;
+
+
+/* header at the start of every frame carved into objects */
+typedef struct slab_t {
+    slabCache_t* sl_cache; /* cache the frame belongs to */
+    unsigned int sl_inUse; /* number of allocated objects of the frame */
+} slab_t;
+
+
+/* key of the element linked by a hash table node */
+typedef unsigned int (*hash_key_t)(const list_head_t* node);
+
+/* hash table of list_heads, resized with the number of elements */
+typedef struct hashTable_t {
+    list_head_t* ht_buckets; /* current bucket array */
+    list_head_t* ht_initial; /* static bucket array, used at the minimum size */
+    unsigned int ht_minBits; /* log2 of the size of the static array */
+    unsigned int ht_bits;    /* log2 of the current number of buckets */
+    unsigned int ht_count;   /* number of elements */
+    hash_key_t   ht_key;     /* key of an element, used when rehashing */
+} hashTable_t;
+
+
 /* Page swap pool information structure type */
 typedef struct swap_t {
     int         sw_asid;   /* ASID number			*/
@@ -10,5 +10,12 @@ int          insertBlocked(const int* semAdd, pcb_t* p);
 pcb_t*       removeBlocked(const int* semAdd);
 pcb_t*       outBlocked(pcb_t* p);
 pcb_t*       headBlocked(const int* semAdd);
+unsigned int removeAllBlocked(const int* semAdd, list_head_t* (*readyQueue)(pcb_t* p));
+
+/* Proprietari dei semafori usati come mutex (priority inheritance) */
+int          setSemOwner(const int* semAdd, pcb_t* p);
+pcb_t*       getSemOwner(const int* semAdd);
+int          ownedWaitersPrio(const pcb_t* p);
+void         disownSems(pcb_t* p);
 
 #endif
@@ -0,0 +1,12 @@
+#ifndef PHASE1_HASH_H_INCLUDED
+#define PHASE1_HASH_H_INCLUDED
+
+#include "pandos_types.h"
+
+/* Tabelle hash ridimensionabili (ASL e indice dei PID) */
+void         initHashTable(hashTable_t* t, list_head_t* initial, unsigned int bits, hash_key_t key);
+list_head_t* hashBucket(const hashTable_t* t, unsigned int k);
+void         hashInsert(hashTable_t* t, list_head_t* node, unsigned int k);
+void         hashRemove(hashTable_t* t, list_head_t* node);
+
+#endif
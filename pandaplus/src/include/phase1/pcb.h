@@ -12,6 +12,7 @@ pcb_t* allocPcb();
 void   mkEmptyProcQ(list_head_t* head);
 int    emptyProcQ(const list_head_t* head);
 void   insertProcQ(list_head_t* head, pcb_t* p);
+void   insertPrioOrderedProcQ(list_head_t* head, pcb_t* p);
 pcb_t* headProcQ(const list_head_t* head);
 pcb_t* removeProcQ(list_head_t* head);
 pcb_t* outProcQ(list_head_t* head, pcb_t* p);
@@ -22,4 +23,9 @@ void   insertChild(pcb_t* prnt, pcb_t* p);
 pcb_t* removeChild(pcb_t* p);
 pcb_t* outChild(pcb_t* p);
 
+/* Indice dei PID */
+void   insertPid(pcb_t* p);
+void   removePid(pcb_t* p);
+pcb_t* findPid(pid_t pid);
+
 #endif
@@ -0,0 +1,17 @@
+#ifndef PHASE1_SLAB_H_INCLUDED
+#define PHASE1_SLAB_H_INCLUDED
+
+#include "pandos_types.h"
+
+/* Frame del pool del kernel */
+void  initSlabs();
+void* allocFrames(unsigned int n);
+void  freeFrames(void* frames, unsigned int n);
+
+/* Gestione delle cache di oggetti (pool di PCB e SEMD) */
+void initSlabCache(slabCache_t* c, list_head_t* freeList, size_t objSize, size_t linkOffset);
+int  slabGrow(slabCache_t* c);
+void slabTake(slabCache_t* c, void* obj);
+void slabPut(slabCache_t* c, void* obj);
+
+#endif
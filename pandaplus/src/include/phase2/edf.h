@@ -0,0 +1,19 @@
+#ifndef PHASE2_EDF_H_INCLUDED
+#define PHASE2_EDF_H_INCLUDED
+
+#include "pandos_types.h"
+
+void         edfInit();
+int          edfAdmit(pcb_t* p, unsigned int period, unsigned int budget);
+void         edfLeave(pcb_t* p);
+int          edfEnqueue(pcb_t* p);
+int          edfDequeue(pcb_t* p);
+list_head_t* edfWakeQueue(pcb_t* p);
+void         edfWakeup();
+pcb_t*       edfPick(unsigned int* quantum);
+int          edfPreempts(pcb_t* p, pcb_t* curr);
+int          edfHandoff(pcb_t* p, unsigned int* quantum);
+void         edfCharge(pcb_t* p, cpu_t time);
+void         edfJobDone(pcb_t* p);
+
+#endif
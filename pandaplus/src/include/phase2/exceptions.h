@@ -3,7 +3,13 @@
 
 #include "pandos_types.h"
 
+/* handler of an exception code, called with the state at the time of the exception */
+typedef void (*exc_handler_t)(state_t* pstate);
+
 void exceptionHandler();
+void exceptionsInit();
+void setExceptionHandler(unsigned int excCode, exc_handler_t handler);
+void exceptionDispatch(state_t* processorState);
 void passUpOrDie(state_t* pstate, unsigned int excType);
 
 #endif
@@ -0,0 +1,17 @@
+#ifndef PHASE2_GROUPS_H_INCLUDED
+#define PHASE2_GROUPS_H_INCLUDED
+
+#include "pandos_types.h"
+
+void         groupsInit();
+int          groupJoin(pcb_t* p, unsigned int group);
+int          groupSetQuota(unsigned int group, unsigned int quota, unsigned int period);
+int          groupPark(pcb_t* p);
+int          groupDequeue(pcb_t* p);
+unsigned int groupsParked();
+void         groupCharge(pcb_t* p, cpu_t time);
+unsigned int groupQuantum(const pcb_t* p, unsigned int quantum);
+int          groupUsage(unsigned int group);
+unsigned int groupThrottles(unsigned int group);
+
+#endif
@@ -6,8 +6,11 @@
 void     contextSwitch();
 void     semSuspend(sem_t* semAddr);
 pcb_t*   semWakeup(sem_t* semAddr);
+unsigned int semWakeupAll(sem_t* semAddr);
 void     insertPrioProcQ(pcb_t* p);
 void     outPrioProcQ(pcb_t* p);
+void     setPrio(pcb_t* p, int prio);
+void     updateInheritedPrio(pcb_t* p);
 int      isDeviceSemaphore(sem_t* semAddr);
 pcb_t*   findPcb(pid_t pid);
 void     kill(pcb_t* proc);
@@ -3,6 +3,14 @@
 
 #include "pandos_types.h"
 
+/* handler of an interrupt line, and of a device with a pending interrupt */
+typedef void (*line_handler_t)(unsigned int line);
+typedef void (*dev_handler_t)(unsigned int line, unsigned int dev);
+
+void interruptsInit();
+void setLineHandler(unsigned int line, line_handler_t handler);
+void setDeviceHandler(unsigned int line, unsigned int dev, dev_handler_t handler);
 void interruptExceptionHandler(state_t* pstate);
+void pseudoClockArm();
 
 #endif
@@ -1,6 +1,30 @@
 #ifndef PHASE2_SCHEDULER_H_INCLUDED
 #define PHASE2_SCHEDULER_H_INCLUDED
 
+#include "pandos_types.h"
+
 void scheduler();
+void handoffScheduler();
+void handoffHint(pcb_t* p);
+void readyNotify(pcb_t* p);
+int  preemptPending();
+
+/*
+ * Scheduling policy, selected at build time:
+ * phase2/mlfq.c (default) or phase2/fair.c (-DSCHED_FAIR)
+ */
+void         schedInit();
+void         schedEnqueue(pcb_t* p);
+void         schedDequeue(pcb_t* p);
+int          schedIsQueued(const pcb_t* p);
+list_head_t* schedWakeQueue(pcb_t* p);
+pcb_t*       schedPick(unsigned int* quantum);
+int          schedPreempts(pcb_t* p, pcb_t* curr);
+int          schedHandoff(pcb_t* p, unsigned int* quantum);
+void         schedNew(pcb_t* p);
+void         schedCharge(pcb_t* p, cpu_t time);
+void         schedPreempted(pcb_t* p);
+void         schedIoBlocked(pcb_t* p);
+void         schedYield(pcb_t* p);
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef PHASE2_SMP_H_INCLUDED
+#define PHASE2_SMP_H_INCLUDED
+
+#include "pandos_types.h"
+
+#if NCPU > 1
+
+void smpInit();
+void kernelLock();
+void kernelUnlock();
+void cpuBusy(int busy);
+void tlbSync();
+unsigned int tlbShootdownStart();
+int          tlbShootdownDone(unsigned int epoch);
+
+#else
+
+/* a single processor: the kernel runs with interrupts masked, nothing to do */
+static inline void smpInit() {}
+static inline void kernelLock() {}
+static inline void kernelUnlock() {}
+static inline void cpuBusy(int busy) { (void) busy; }
+static inline void tlbSync() {}
+static inline unsigned int tlbShootdownStart() { return 0; }
+static inline int tlbShootdownDone(unsigned int epoch) { (void) epoch; return 1; }
+
+#endif
+
+int cpusRunning();
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef PHASE2_TIMERS_H_INCLUDED
+#define PHASE2_TIMERS_H_INCLUDED
+
+#include "pandos_types.h"
+
+void timersInit();
+void timerArm(ktimer_t* t, unsigned int expiry);
+void timerCancel(ktimer_t* t);
+int  timerArmed(const ktimer_t* t);
+void timersAck();
+void timersExpire();
+
+#endif
@@ -10,12 +10,16 @@
 extern unsigned int processCount;
 /* number of blocked processes (due to an I/O or timer request) */
 extern unsigned int softBlockCount;
-/* current executing process */
-extern pcb_t*       currentProcess;
-/* queue of low priority (and ready) processes */
-extern list_head_t* procQLow;
-/* queue of high priority (and ready) processes */
-extern list_head_t* procQHigh;
+/* executing process of each processor (NULL if idle) */
+extern pcb_t*       currentProcs[NCPU];
+/* current executing process (of this processor) */
+#define currentProcess (currentProcs[CPUID()])
+/* number of jobs of the real-time processes that missed their deadline */
+extern unsigned int deadlineMisses;
+/* interrupt exception entries, and interrupts served in them (more than one per entry) */
+extern unsigned int interruptEntries, interruptsServiced;
+/* deferred work items run, and most items queued at once */
+extern unsigned int workItems, workMaxDepth;
 
 /* pseudo-clock sync semaphore (used in NSYS7) */
 extern sem_t pseudoClockSem;
@@ -26,8 +30,8 @@ extern sem_t termSems[2][DEVPERINT];
 
 /*
  * boolean used to flag the scheduler to try to skip for the current scheduling
- * the queue of high priority processes
- * and indeed to force the queue of low priority processes
+ * the top level (where high priority processes start from)
+ * and indeed to force the lower levels
  * used primarily in the yield syscall
  */
 extern int forceLowQ;
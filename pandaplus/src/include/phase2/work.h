@@ -0,0 +1,11 @@
+#ifndef PHASE2_WORK_H_INCLUDED
+#define PHASE2_WORK_H_INCLUDED
+
+#include "pandos_types.h"
+
+void workInit();
+void workQueue(work_t* w);
+int  workQueued(const work_t* w);
+void workRun();
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef PHASE3_SYSSUPPORT_H_INCLUDED
 #define PHASE3_SYSSUPPORT_H_INCLUDED
 
+#include "pandos_types.h"
+
 void initSysStructs();
-void generalExceptionHandler();
+void generalExceptionHandler(support_t* psupport);
 
 #endif
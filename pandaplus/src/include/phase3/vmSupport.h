@@ -1,8 +1,10 @@
 #ifndef PHASE3_VMSUPPORT_H_INCLUDED
 #define PHASE3_VMSUPPORT_H_INCLUDED
 
+#include "pandos_types.h"
+
 void initVmStructs();
 void uTLB_RefillHandler();
-void tlbExceptionHandler();
+void tlbExceptionHandler(support_t* psupport);
 
 #endif
@@ -4,6 +4,9 @@
 #include "pandos_types.h"
 
 void* memcpy(void* dest, const void* src, size_t n);
+void* memset(void* dest, int c, size_t n);
+void  stateCopy(state_t* dest, const state_t* src);
+void  stateClear(state_t* s);
 unsigned int msb(unsigned int v);
 unsigned int lsb(unsigned int v);
 
@@ -3,10 +3,14 @@
 #include "listx.h"
 #include "phase1/asl.h"
 #include "phase1/pcb.h"
+#include "phase1/slab.h"
+#include "phase1/hash.h"
 
 HIDDEN semd_t* allocSemd(const int* semAdd);
 HIDDEN void    freeSemd(semd_t* s);
+HIDDEN void    putSemd(semd_t* s);
 HIDDEN semd_t* getSemd(const int* semAdd);
+HIDDEN unsigned int semdKey(const list_head_t* node);
 
 /* sentinella della lista dei SEMD liberi */
 HIDDEN LIST_HEAD(semdFree_sentinel);
@@ -18,13 +22,26 @@ HIDDEN LIST_HEAD(semd_sentinel);
 /* head della lista dei SEMD attivi (ASL) */
 HIDDEN list_head_t* semd_h = &semd_sentinel;
 
-/* array di SEMD */
+/* array di SEMD (pool iniziale, sempre disponibile) */
 HIDDEN semd_t semd_table[MAXPROC];
 
+/* cache dei SEMD, estesa a runtime con i frame del pool del kernel */
+HIDDEN slabCache_t semdCache;
+
+/* bucket iniziali della tabella hash dei SEMD attivi */
+HIDDEN list_head_t semdHash_initial[SEMD_HASH_SIZE];
+/* tabella hash dei SEMD attivi (bucket indicizzati dalla key), ridimensionata con l'ASL */
+HIDDEN hashTable_t semdHash_table;
+
+
+HIDDEN unsigned int semdKey(const list_head_t* node) {
+    /* la key di un SEMD nella tabella hash è l'indirizzo del semaforo */
+    return (memaddr) container_of(node, semd_t, s_hash)->s_key;
+}
 
 HIDDEN semd_t* allocSemd(const int* semAdd) {
-    /* la lista dei SEMD liberi è vuota? */
-    if (list_empty(semdFree_h)) {
+    /* la lista dei SEMD liberi è vuota e non è possibile estenderla con un nuovo frame? */
+    if (list_empty(semdFree_h) && slabGrow(&semdCache) != 0) {
         return NULL;
     }
 
@@ -33,6 +50,7 @@ HIDDEN semd_t* allocSemd(const int* semAdd) {
 
     /* rimuove s dalla lista dei SEMD liberi */
     list_del(&s->s_link);
+    slabTake(&semdCache, s);
 
     /* inserisce s nella lista dei SEMD attivi */
     list_add(&s->s_link, semd_h);
@@ -40,23 +58,38 @@ HIDDEN semd_t* allocSemd(const int* semAdd) {
     /* inizializza tutti i campi di s */
     s->s_key = (int*) semAdd;
     mkEmptyProcQ(&s->s_procq);
+    s->s_owner = NULL;
+    INIT_LIST_HEAD(&s->s_ownedLink);
+
+    /* inserisce s nel bucket della tabella hash corrispondente a semAdd (s_key serve se la tabella cresce) */
+    hashInsert(&semdHash_table, &s->s_hash, (memaddr) semAdd);
 
     return s;
 }
 
 HIDDEN void freeSemd(semd_t* s) {
-    /* rimuove s dalla lista dei SEMD attivi */
+    /* rimuove s dalla lista dei SEMD attivi e dal suo bucket */
     list_del(&s->s_link);
+    hashRemove(&semdHash_table, &s->s_hash);
 
     /* inserisce s nella lista dei SEMD liberi */
     list_add(&s->s_link, semdFree_h);
+    /* se il frame di s è diventato inutilizzato, può essere restituito al pool */
+    slabPut(&semdCache, s);
+}
+
+HIDDEN void putSemd(semd_t* s) {
+    /* il SEMD resta attivo finché ha processi bloccati o un proprietario */
+    if (emptyProcQ(&s->s_procq) && s->s_owner == NULL) {
+        freeSemd(s);
+    }
 }
 
 HIDDEN semd_t* getSemd(const int* semAdd) {
     semd_t* current;
 
-    /* cerca un SEMD con key semAdd nella lista dei SEMD liberi */
-    list_for_each_entry(current, semd_h, s_link) {
+    /* cerca un SEMD con key semAdd nel solo bucket corrispondente (O(1) in media) */
+    list_for_each_entry(current, hashBucket(&semdHash_table, (memaddr) semAdd), s_hash) {
         if (current->s_key == semAdd) {
             return current;
         }
@@ -67,10 +100,16 @@ HIDDEN semd_t* getSemd(const int* semAdd) {
 
 
 void initASL() {
+    initSlabCache(&semdCache, semdFree_h, sizeof(semd_t), offsetof(semd_t, s_link));
+
     /* aggiunge ogni elemento dell'array di SEMD nella lista dei SEMD liberi */
     for (int i = 0; i < MAXPROC; ++i) {
         list_add(&semd_table[i].s_link, semdFree_h);
+        slabPut(&semdCache, &semd_table[i]);
     }
+
+    /* la tabella hash parte vuota, con i bucket dell'array statico */
+    initHashTable(&semdHash_table, semdHash_initial, SEMD_HASH_BITS, semdKey);
 }
 
 list_head_t* getSemdHead()
@@ -89,7 +128,8 @@ int insertBlocked(const int* semAdd, pcb_t* p) {
      */
     if ((s = getSemd(semAdd)) != NULL || (s = allocSemd(semAdd)) != NULL) {
         p->p_semAdd = (int*) semAdd;
-        insertProcQ(&s->s_procq, p);
+        /* i processi a priorità più alta vengono risvegliati per primi */
+        insertPrioOrderedProcQ(&s->s_procq, p);
         return 0;
     }
 
@@ -106,38 +146,43 @@ pcb_t* removeBlocked(const int* semAdd) {
 
     /* rimuove il PCB in testa alla coda dei processi bloccati di s */
     pcb_t* p = removeProcQ(&s->s_procq);
-    p->p_semAdd = NULL;
 
-    /* se la coda dei processi è vuota dopo la rimozione, libera il SEMD */
-    if (emptyProcQ(&s->s_procq)) {
-        freeSemd(s);
+    /* un SEMD con un proprietario può non avere processi bloccati */
+    if (p == NULL) {
+        return NULL;
     }
 
+    p->p_semAdd = NULL;
+
+    /* se la coda dei processi è vuota dopo la rimozione (e s non ha un proprietario), libera il SEMD */
+    putSemd(s);
+
     return p;
 }
 
 pcb_t* outBlocked(pcb_t* p) {
-    semd_t* s = getSemd(p->p_semAdd);
-
-    /* semAdd valido? */
-    if (s == NULL) {
+    /* p è bloccato su un semaforo? */
+    if (p->p_semAdd == NULL || p->p_queue == NULL) {
         return NULL;
     }
 
-    /* rimuove p dalla coda dei processi bloccati di s */
-    p = outProcQ(&s->s_procq, p);
+    /*
+     * il SEMD di p si ricava dalla coda in cui p è inserito
+     * senza doverlo cercare nella ASL
+     */
+    semd_t* s = container_of(p->p_queue, semd_t, s_procq);
 
-    /* p non rimosso */
-    if (p == NULL) {
+    /* la coda di p appartiene davvero al SEMD con key p->p_semAdd? */
+    if (s->s_key != p->p_semAdd) {
         return NULL;
     }
 
+    /* rimuove p dalla coda dei processi bloccati di s */
+    outProcQ(&s->s_procq, p);
     p->p_semAdd = NULL;
 
-    /* se la coda dei processi è vuota dopo la rimozione, libera il SEMD */
-    if (emptyProcQ(&s->s_procq)) {
-        freeSemd(s);
-    }
+    /* se la coda dei processi è vuota dopo la rimozione (e s non ha un proprietario), libera il SEMD */
+    putSemd(s);
 
     return p;
 }
@@ -153,3 +198,113 @@ pcb_t* headBlocked(const int* semAdd) {
     /* restituisce il PCB in testa alla coda dei processi bloccati di s */
     return headProcQ(&s->s_procq);
 }
+
+unsigned int removeAllBlocked(const int* semAdd, list_head_t* (*readyQueue)(pcb_t* p)) {
+    semd_t* s = getSemd(semAdd);
+
+    /* semAdd valido? */
+    if (s == NULL) {
+        return 0;
+    }
+
+    list_head_t* q = &s->s_procq;
+    unsigned int n = 0;
+
+    /*
+     * un solo passaggio sulla coda: i PCB non sono più bloccati e ricordano
+     * la coda in cui verranno spostati; ogni sequenza di PCB consecutivi
+     * destinati alla stessa coda viene spostata in blocco
+     * (la coda è ordinata per priorità, quindi le sequenze sono poche)
+     */
+    while (!emptyProcQ(q)) {
+        list_head_t* first = q->next;
+        list_head_t* last = first;
+        list_head_t* dest = readyQueue(container_of(first, pcb_t, p_list));
+
+        for (;;) {
+            pcb_t* p = container_of(last, pcb_t, p_list);
+            p->p_semAdd = NULL;
+            p->p_queue = dest;
+            ++n;
+
+            if (last->next == q || readyQueue(container_of(last->next, pcb_t, p_list)) != dest) {
+                break;
+            }
+            last = last->next;
+        }
+
+        list_move_range_tail(first, last, dest);
+    }
+
+    /* la coda dei processi è vuota: libera il SEMD (se non ha un proprietario) */
+    putSemd(s);
+
+    return n;
+}
+
+int setSemOwner(const int* semAdd, pcb_t* p) {
+    semd_t* s = getSemd(semAdd);
+
+    if (p == NULL) {
+        /* il semaforo non ha (più) un proprietario */
+        if (s != NULL && s->s_owner != NULL) {
+            list_del(&s->s_ownedLink);
+            s->s_owner = NULL;
+            putSemd(s);
+        }
+
+        return 0;
+    }
+
+    /* serve un SEMD anche senza processi bloccati, per ricordare il proprietario */
+    if (s == NULL && (s = allocSemd(semAdd)) == NULL) {
+        return 1;
+    }
+
+    /* rimuove s dai semafori del vecchio proprietario e lo inserisce tra quelli di p */
+    if (s->s_owner != NULL) {
+        list_del(&s->s_ownedLink);
+    }
+    s->s_owner = p;
+    list_add(&s->s_ownedLink, &p->p_owned);
+
+    return 0;
+}
+
+pcb_t* getSemOwner(const int* semAdd) {
+    semd_t* s = getSemd(semAdd);
+
+    /* semAdd valido? */
+    if (s == NULL) {
+        return NULL;
+    }
+
+    return s->s_owner;
+}
+
+int ownedWaitersPrio(const pcb_t* p) {
+    semd_t* s;
+    int prio = PROCESS_PRIO_LOW;
+
+    /* le code sono ordinate per priorità: basta guardare il PCB in testa a ciascuna */
+    list_for_each_entry(s, &p->p_owned, s_ownedLink) {
+        pcb_t* head = headProcQ(&s->s_procq);
+
+        if (head != NULL && head->p_prio > prio) {
+            prio = head->p_prio;
+        }
+    }
+
+    return prio;
+}
+
+void disownSems(pcb_t* p) {
+    /* p non possiede più nessun semaforo */
+    while (!list_empty(&p->p_owned)) {
+        semd_t* s = container_of(p->p_owned.next, semd_t, s_ownedLink);
+
+        list_del(&s->s_ownedLink);
+        s->s_owner = NULL;
+        putSemd(s);
+    }
+}
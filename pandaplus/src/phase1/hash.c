@@ -0,0 +1,102 @@
+#include "pandos_types.h"
+#include "pandos_const.h"
+#include "listx.h"
+#include "phase1/hash.h"
+#include "phase1/slab.h"
+
+HIDDEN unsigned int hashIndex(unsigned int k, unsigned int bits);
+HIDDEN unsigned int hashFrames(unsigned int bits);
+HIDDEN void         hashResize(hashTable_t* t, unsigned int bits);
+
+
+HIDDEN unsigned int hashIndex(unsigned int k, unsigned int bits) {
+    /*
+     * hashing moltiplicativo: i bit alti del prodotto dipendono da tutti i bit della key,
+     * così anche key allineate o consecutive si distribuiscono tra i bucket
+     */
+    return (k * HASH_GOLDEN) >> (32 - bits);
+}
+
+HIDDEN unsigned int hashFrames(unsigned int bits) {
+    /* numero di frame necessari per un array di 2^bits bucket */
+    return ((sizeof(list_head_t) << bits) + PAGESIZE - 1) / PAGESIZE;
+}
+
+HIDDEN void hashResize(hashTable_t* t, unsigned int bits) {
+    list_head_t* buckets;
+
+    /* alla dimensione minima si usa l'array statico, altrimenti frame contigui del pool */
+    if (bits == t->ht_minBits) {
+        buckets = t->ht_initial;
+    } else if ((buckets = allocFrames(hashFrames(bits))) == NULL) {
+        /* pool esaurito: la tabella resta corretta, solo con bucket più lunghi */
+        return;
+    }
+
+    for (unsigned int i = 0; i < (1U << bits); ++i) {
+        INIT_LIST_HEAD(&buckets[i]);
+    }
+
+    /* sposta ogni elemento nel bucket corrispondente della nuova tabella */
+    for (unsigned int i = 0; i < (1U << t->ht_bits); ++i) {
+        while (!list_empty(&t->ht_buckets[i])) {
+            list_head_t* node = t->ht_buckets[i].next;
+
+            list_del(node);
+            list_add(node, &buckets[hashIndex(t->ht_key(node), bits)]);
+        }
+    }
+
+    /* i frame della vecchia tabella tornano al pool */
+    if (t->ht_buckets != t->ht_initial) {
+        freeFrames(t->ht_buckets, hashFrames(t->ht_bits));
+    }
+
+    t->ht_buckets = buckets;
+    t->ht_bits = bits;
+}
+
+
+void initHashTable(hashTable_t* t, list_head_t* initial, unsigned int bits, hash_key_t key) {
+    t->ht_buckets = t->ht_initial = initial;
+    t->ht_bits = t->ht_minBits = bits;
+    t->ht_count = 0;
+    t->ht_key = key;
+
+    /* inizializza i bucket come vuoti */
+    for (unsigned int i = 0; i < (1U << bits); ++i) {
+        INIT_LIST_HEAD(&initial[i]);
+    }
+}
+
+list_head_t* hashBucket(const hashTable_t* t, unsigned int k) {
+    return &t->ht_buckets[hashIndex(k, t->ht_bits)];
+}
+
+void hashInsert(hashTable_t* t, list_head_t* node, unsigned int k) {
+    list_add(node, hashBucket(t, k));
+
+    /* carico medio oltre la soglia: raddoppia il numero di bucket (costo ammortizzato O(1)) */
+    if (++t->ht_count > (HASH_MAXLOAD << t->ht_bits)) {
+        hashResize(t, t->ht_bits + 1);
+    }
+}
+
+void hashRemove(hashTable_t* t, list_head_t* node) {
+    /* il nodo non è mai stato inserito (o è già stato rimosso)? */
+    if (list_empty(node)) {
+        return;
+    }
+
+    list_del(node);
+    INIT_LIST_HEAD(node);
+    --t->ht_count;
+
+    /*
+     * carico medio sotto 1/4: dimezza il numero di bucket, restituendo i frame al pool
+     * (dopo il dimezzamento il carico resta sotto 1/2, lontano dalla soglia di crescita)
+     */
+    if (t->ht_bits > t->ht_minBits && (t->ht_count << 2) < (1U << t->ht_bits)) {
+        hashResize(t, t->ht_bits - 1);
+    }
+}
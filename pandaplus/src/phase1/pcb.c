@@ -1,32 +1,61 @@
 #include "pandos_types.h"
 #include "pandos_const.h"
 #include "listx.h"
+#include "utils.h"
 #include "phase1/pcb.h"
+#include "phase1/slab.h"
+#include "phase1/hash.h"
+
+HIDDEN unsigned int pidKey(const list_head_t* node);
 
 /* sentinella della lista dei PCB liberi */
 HIDDEN LIST_HEAD(pcbFree_sentinel);
 /* head lista dei PCB liberi */
 HIDDEN list_head_t* pcbFree_h = &pcbFree_sentinel;
 
-/* array di PCB */
+/* array di PCB (pool iniziale, sempre disponibile) */
 HIDDEN pcb_t pcbFree_table[MAXPROC];
 
+/* cache dei PCB, estesa a runtime con i frame del pool del kernel */
+HIDDEN slabCache_t pcbCache;
+
+/* bucket iniziali dell'indice dei PID */
+HIDDEN list_head_t pidHash_initial[PID_HASH_SIZE];
+/* tabella hash dei PCB allocati, indicizzata dal PID e ridimensionata con il pool dei PCB */
+HIDDEN hashTable_t pidHash_table;
+
+
+HIDDEN unsigned int pidKey(const list_head_t* node) {
+    /* la key di un PCB nell'indice è il suo PID */
+    return container_of(node, pcb_t, p_pidLink)->p_pid;
+}
+
 
 void initPcbs() {
+    initSlabCache(&pcbCache, pcbFree_h, sizeof(pcb_t), offsetof(pcb_t, p_list));
+
     /* aggiunge ogni elemento dell'array di PCB nella lista dei PCB liberi */
     for (int i = 0; i < MAXPROC; ++i) {
         list_add(&pcbFree_table[i].p_list, pcbFree_h);
+        slabPut(&pcbCache, &pcbFree_table[i]);
     }
+
+    /* l'indice dei PID parte vuoto, con i bucket dell'array statico */
+    initHashTable(&pidHash_table, pidHash_initial, PID_HASH_BITS, pidKey);
 }
 
 void freePcb(pcb_t* p) {
+    removePid(p);
+
     /* inserisce p nella lista dei PCB liberi */
     list_add(&p->p_list, pcbFree_h);
+    /* se il frame di p è diventato inutilizzato, può essere restituito al pool */
+    slabPut(&pcbCache, p);
 }
 
 pcb_t* allocPcb() {
-    /* la lista dei PCB liberi è vuota? */
-    if (list_empty(pcbFree_h)) {
+    /* la lista dei PCB liberi è vuota e non è possibile estenderla con un nuovo frame? */
+    if (list_empty(pcbFree_h) && slabGrow(&pcbCache) != 0) {
         return NULL;
     }
 
@@ -35,28 +64,43 @@ pcb_t* allocPcb() {
 
     /* rimuove p dalla lista dei PCB liberi */
     list_del(&p->p_list);
+    slabTake(&pcbCache, p);
  
     /* inizializza tutti i campi di p a NULL/0 */
-    p->p_list.next = NULL;
-    p->p_list.prev = NULL;
+    p->p_queue = NULL;
+    p->p_semAdd = NULL;
+    p->p_time = 0;
+    p->p_pid = 0;
     p->p_parent = NULL;
     INIT_LIST_HEAD(&p->p_child);
     p->p_sib.next = NULL;
     p->p_sib.prev = NULL;
-    p->p_time = 0;
-    p->p_semAdd = NULL;
+    INIT_LIST_HEAD(&p->p_pidLink);
+    INIT_LIST_HEAD(&p->p_owned);
+    /* il timer di SLEEP non è armato (i link a NULL, che non vale necessariamente 0) */
+    p->p_sleepTimer.t_link.next = NULL;
+    p->p_sleepTimer.t_link.prev = NULL;
+    /* p non è in terminazione (vedi kill) */
+    p->p_dying = 0;
+    /* i nuovi processi non sono real-time (vedi SETREALTIME) */
+    p->p_rtPeriod = 0;
+    /* e sono nel gruppo 0, senza quota (createProcess assegna quello del creatore) */
+    p->p_group = 0;
+
+#ifndef PCB_LAZY_INIT
+    /*
+     * con PCB_LAZY_INIT vengono saltati i campi che chi crea il processo
+     * (createProcess) sovrascrive comunque: p_list, p_prio, p_basePrio, p_supportStruct e p_s
+     */
+    p->p_list.next = NULL;
+    p->p_list.prev = NULL;
+    p->p_prio = PROCESS_PRIO_LOW;
+    p->p_basePrio = PROCESS_PRIO_LOW;
     p->p_supportStruct = NULL;
 
-    /* inizializza il campo p_s di p a 0 */
-    for (int i = 0; i < STATE_GPR_LEN; ++i) {
-        p->p_s.gpr[i] = 0;
-    }
-    p->p_s.entry_hi = 0;
-    p->p_s.cause = 0;
-    p->p_s.status = 0;
-    p->p_s.pc_epc = 0;
-    p->p_s.hi = 0;
-    p->p_s.lo = 0;
+    /* inizializza il campo p_s di p a 0 (una word alla volta) */
+    stateClear(&p->p_s);
+#endif
 
     return p;
 }
@@ -74,6 +118,28 @@ int emptyProcQ(const list_head_t* head) {
 void insertProcQ(list_head_t* head, pcb_t* p) {
     /* inserisce p nella coda dei processi */
     list_add_tail(&p->p_list, head);
+    /* ricorda in quale coda si trova p */
+    p->p_queue = head;
+}
+
+void insertPrioOrderedProcQ(list_head_t* head, pcb_t* p) {
+    list_head_t* pos;
+
+    /*
+     * cerca, partendo dalla coda, l'ultimo PCB con priorità almeno pari a quella di p:
+     * la coda resta ordinata per priorità e FIFO tra PCB con la stessa priorità
+     * (O(1) quando tutti i PCB hanno la stessa priorità)
+     */
+    list_for_each_prev(pos, head) {
+        if (container_of(pos, pcb_t, p_list)->p_prio >= p->p_prio) {
+            break;
+        }
+    }
+
+    /* inserisce p subito dopo pos */
+    list_add(&p->p_list, pos);
+    /* ricorda in quale coda si trova p */
+    p->p_queue = head;
 }
 
 pcb_t* headProcQ(const list_head_t* head) {
@@ -97,24 +163,25 @@ pcb_t* removeProcQ(list_head_t* head) {
 
     /* rimuove p dalla coda dei processi */
     list_del(&p->p_list);
+    p->p_queue = NULL;
 
     return p;
 }
 
 pcb_t* outProcQ(list_head_t* head, pcb_t* p) {
-    pcb_t* current;
-
-    /* cerca un p nella coda dei processi */
-    list_for_each_entry(current, head, p_list) {
-        if (current == p) {
-            /* rimuove p dalla coda dei processi */
-            list_del(&current->p_list);
-            return current;
-        }
+    /*
+     * p si trova nella coda dei processi?
+     * basta confrontare head con la coda registrata in p, senza scorrere la coda
+     */
+    if (p->p_queue != head) {
+        return NULL;
     }
 
-    /* altrimenti se p non si trova nella coda dei processi */
-    return NULL;
+    /* rimuove p dalla coda dei processi */
+    list_del(&p->p_list);
+    p->p_queue = NULL;
+
+    return p;
 }
 
 int emptyChild(const pcb_t* p) {
@@ -156,3 +223,26 @@ pcb_t* outChild(pcb_t* p) {
 
     return p;
 }
+
+void insertPid(pcb_t* p) {
+    /* inserisce p nel bucket corrispondente al suo PID */
+    hashInsert(&pidHash_table, &p->p_pidLink, p->p_pid);
+}
+
+void removePid(pcb_t* p) {
+    /* rimuove p dall'indice dei PID (nessun effetto se p non vi è mai stato inserito) */
+    hashRemove(&pidHash_table, &p->p_pidLink);
+}
+
+pcb_t* findPid(pid_t pid) {
+    pcb_t* current;
+
+    /* cerca il PCB con PID pid nel solo bucket corrispondente (O(1) in media) */
+    list_for_each_entry(current, hashBucket(&pidHash_table, pid), p_pidLink) {
+        if (current->p_pid == pid) {
+            return current;
+        }
+    }
+
+    return NULL;
+}
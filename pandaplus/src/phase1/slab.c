@@ -0,0 +1,132 @@
+#include "pandos_types.h"
+#include "pandos_const.h"
+#include "listx.h"
+#include "phase1/slab.h"
+
+/* spazio riservato all'header di ogni frame (arrotondato a 8 byte per l'allineamento) */
+#define SLAB_HDRSIZE ((sizeof(slab_t) + 7) & ~7)
+
+/* list_head di collegamento dell'oggetto obj */
+#define SLAB_LINK(c, obj) ((list_head_t*) ((char*) (obj) + (c)->c_linkOffset))
+
+HIDDEN slab_t* getSlab(const void* obj);
+
+/* inizio del pool di frame del kernel */
+HIDDEN char* const kpool = (char*) KPOOLSTART;
+
+/* frame del pool attualmente in uso (1) o liberi (0) */
+HIDDEN unsigned char frameUsed[KPOOLFRAMES];
+
+
+HIDDEN slab_t* getSlab(const void* obj) {
+    /* gli oggetti degli array statici non appartengono a nessun frame del pool */
+    if ((char*) obj < kpool || (char*) obj >= kpool + KPOOLFRAMES * PAGESIZE) {
+        return NULL;
+    }
+
+    /* l'header si trova all'inizio del frame che contiene obj */
+    return (slab_t*) (kpool + ((char*) obj - kpool) / PAGESIZE * PAGESIZE);
+}
+
+
+void initSlabs() {
+    /* all'avvio tutti i frame del pool sono liberi */
+    for (int i = 0; i < KPOOLFRAMES; ++i) {
+        frameUsed[i] = 0;
+    }
+}
+
+void* allocFrames(unsigned int n) {
+    unsigned int run = 0;
+
+    /* cerca n frame liberi consecutivi nel pool (first fit) */
+    for (unsigned int i = 0; i < KPOOLFRAMES; ++i) {
+        run = frameUsed[i] ? 0 : run + 1;
+
+        if (run == n) {
+            for (unsigned int j = i + 1 - n; j <= i; ++j) {
+                frameUsed[j] = 1;
+            }
+            return kpool + (i + 1 - n) * PAGESIZE;
+        }
+    }
+
+    /* pool esaurito (o troppo frammentato) */
+    return NULL;
+}
+
+void freeFrames(void* frames, unsigned int n) {
+    unsigned int first = ((char*) frames - kpool) / PAGESIZE;
+
+    for (unsigned int i = first; i < first + n; ++i) {
+        frameUsed[i] = 0;
+    }
+}
+
+void initSlabCache(slabCache_t* c, list_head_t* freeList, size_t objSize, size_t linkOffset) {
+    c->c_free = freeList;
+    c->c_objSize = objSize;
+    c->c_linkOffset = linkOffset;
+    c->c_freeCount = 0;
+}
+
+int slabGrow(slabCache_t* c) {
+    slab_t* sl = allocFrames(1);
+
+    /* nessun frame disponibile? */
+    if (sl == NULL) {
+        return 1;
+    }
+
+    sl->sl_cache = c;
+    sl->sl_inUse = 0;
+
+    /* suddivide il resto del frame in oggetti e li inserisce nella lista di quelli liberi */
+    for (char* obj = (char*) sl + SLAB_HDRSIZE; obj + c->c_objSize <= (char*) sl + PAGESIZE; obj += c->c_objSize) {
+        list_add_tail(SLAB_LINK(c, obj), c->c_free);
+        ++c->c_freeCount;
+    }
+
+    return 0;
+}
+
+void slabTake(slabCache_t* c, void* obj) {
+    slab_t* sl = getSlab(obj);
+
+    /* obj è stato rimosso dalla lista degli oggetti liberi */
+    --c->c_freeCount;
+
+    if (sl != NULL) {
+        ++sl->sl_inUse;
+    }
+}
+
+void slabPut(slabCache_t* c, void* obj) {
+    slab_t* sl = getSlab(obj);
+
+    /* obj è stato reinserito nella lista degli oggetti liberi */
+    ++c->c_freeCount;
+
+    if (sl == NULL || --sl->sl_inUse > 0) {
+        return;
+    }
+
+    /* numero di oggetti contenuti in un frame */
+    unsigned int perFrame = (PAGESIZE - SLAB_HDRSIZE) / c->c_objSize;
+
+    /*
+     * il frame è interamente libero: lo restituisce al pool
+     * solo se restano almeno altrettanti oggetti liberi nella cache,
+     * così da non liberare e riallocare continuamente lo stesso frame
+     */
+    if (c->c_freeCount < 2 * perFrame) {
+        return;
+    }
+
+    for (char* o = (char*) sl + SLAB_HDRSIZE; o + c->c_objSize <= (char*) sl + PAGESIZE; o += c->c_objSize) {
+        list_del(SLAB_LINK(c, o));
+    }
+    c->c_freeCount -= perFrame;
+
+    freeFrames(sl, 1);
+}
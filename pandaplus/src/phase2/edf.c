@@ -0,0 +1,292 @@
+#include <umps/libumps.h>
+#include "pandos_types.h"
+#include "pandos_const.h"
+
+#include "phase2/edf.h"
+#include "phase2/scheduler.h"
+#include "phase2/variables.h"
+#include "phase1/pcb.h"
+
+/*
+ * Earliest deadline first real-time class
+ * it comes before the scheduling policy: the ready real-time processes
+ * that still have budget for their current job are dispatched first,
+ * in order of deadline; the ones that exhausted it fall back to the
+ * scheduling policy (with their priority) until their next job
+ *
+ * a job is released when the process gets ready after completing the
+ * previous one (CLOCKWAIT), its deadline is one period later; a job not
+ * completed by its deadline is a deadline miss and the next one is released
+ */
+
+/* ready real-time processes, ordered by deadline */
+HIDDEN list_head_t edfQueue;
+/*
+ * processes woken up all at once (see semWakeupAll),
+ * moved in the EDF queue right after by edfWakeup
+ */
+HIDDEN list_head_t wakeQueue;
+/* utilization of the admitted processes (thousandths) */
+HIDDEN unsigned int edfUtil;
+
+/*
+ * Time comparison, robust to the wraparound of the TOD clock
+ */
+HIDDEN inline int timeBefore(unsigned int a, unsigned int b)
+{
+    return (int) (a - b) < 0;
+}
+
+HIDDEN inline unsigned int utilOf(unsigned int period, unsigned int budget)
+{
+    return budget * 1000 / period;
+}
+
+/*
+ * Start a new job of the process (with a full budget)
+ */
+HIDDEN void releaseJob(pcb_t* p, unsigned int now)
+{
+    p->p_rtDeadline = now + p->p_rtPeriod;
+    p->p_rtLeft = p->p_rtBudget;
+    p->p_rtDone = 0;
+}
+
+/*
+ * Bring the current job of the process up to date:
+ * a completed job is followed by a new one, as well as a job past its deadline
+ * (that is a deadline miss)
+ */
+HIDDEN void updateJob(pcb_t* p)
+{
+    cpu_t now;
+    STCK(now);
+
+    if (p->p_rtDone) {
+        releaseJob(p, now);
+    } else if (!timeBefore(now, p->p_rtDeadline)) {
+        ++deadlineMisses;
+        releaseJob(p, now);
+    }
+}
+
+void edfInit()
+{
+    mkEmptyProcQ(&edfQueue);
+    mkEmptyProcQ(&wakeQueue);
+    edfUtil = 0;
+    deadlineMisses = 0;
+}
+
+/*
+ * Admission control
+ * make p a real-time process with the given period and budget (us),
+ * provided that the utilization of all the real-time processes stays within EDF_MAX_UTIL;
+ * a zero period makes p a normal process again
+ * returns 0 on success, -1 if rejected
+ */
+int edfAdmit(pcb_t* p, unsigned int period, unsigned int budget)
+{
+    if (period == 0) {
+        edfLeave(p);
+        return 0;
+    }
+
+    if (period > EDF_MAX_PERIOD || budget == 0 || budget > period) {
+        return -1;
+    }
+
+    unsigned int util = utilOf(period, budget);
+    unsigned int oldUtil = p->p_rtPeriod != 0 ? utilOf(p->p_rtPeriod, p->p_rtBudget) : 0;
+    if (edfUtil - oldUtil + util > EDF_MAX_UTIL) {
+        return -1;
+    }
+
+    edfUtil += util - oldUtil;
+    p->p_rtPeriod = period;
+    p->p_rtBudget = budget;
+
+    cpu_t now;
+    STCK(now);
+    releaseJob(p, now);
+
+    return 0;
+}
+
+/*
+ * p is no longer a real-time process (or it's terminating)
+ * p must not be in the EDF queue
+ */
+void edfLeave(pcb_t* p)
+{
+    if (p->p_rtPeriod != 0) {
+        edfUtil -= utilOf(p->p_rtPeriod, p->p_rtBudget);
+        p->p_rtPeriod = 0;
+    }
+}
+
+/*
+ * Insert the process in the EDF queue, if it's a real-time process
+ * with some budget left for its current job
+ * returns 1 if inserted, 0 if the process belongs to the scheduling policy
+ */
+int edfEnqueue(pcb_t* p)
+{
+    if (p->p_rtPeriod == 0) {
+        return 0;
+    }
+
+    updateJob(p);
+    if (p->p_rtLeft == 0) {
+        /* throttled up to its next job */
+        return 0;
+    }
+
+    /* FIFO between processes with the same deadline (O(1) for the latest deadline) */
+    list_head_t* pos;
+    list_for_each_prev(pos, &edfQueue) {
+        if (!timeBefore(p->p_rtDeadline, container_of(pos, pcb_t, p_list)->p_rtDeadline)) {
+            break;
+        }
+    }
+
+    list_add(&p->p_list, pos);
+    p->p_queue = &edfQueue;
+
+    return 1;
+}
+
+/*
+ * Remove the process from the EDF queue
+ * returns 1 if it was in there (or in the wake queue), 0 otherwise
+ */
+int edfDequeue(pcb_t* p)
+{
+    if (p->p_queue != &edfQueue && p->p_queue != &wakeQueue) {
+        return 0;
+    }
+
+    outProcQ(p->p_queue, p);
+    return 1;
+}
+
+/*
+ * Queue the process is spliced in when woken up all at once (see semWakeupAll)
+ */
+list_head_t* edfWakeQueue(pcb_t* p)
+{
+    return p->p_rtPeriod != 0 ? &wakeQueue : schedWakeQueue(p);
+}
+
+/*
+ * Move the real-time processes woken up all at once in the EDF queue
+ * (their new jobs are released now)
+ */
+void edfWakeup()
+{
+    pcb_t* p;
+    while ((p = removeProcQ(&wakeQueue)) != NULL) {
+        if (!edfEnqueue(p)) {
+            schedEnqueue(p);
+        }
+        readyNotify(p);
+    }
+}
+
+/*
+ * Dispatch the real-time process with the earliest deadline,
+ * the quantum is the budget left for its job (enforced by the PLT)
+ * returns NULL if there are no ready real-time processes
+ */
+pcb_t* edfPick(unsigned int* quantum)
+{
+    pcb_t* p;
+
+    /* jobs that passed their deadline while waiting in the queue are missed */
+    cpu_t now;
+    STCK(now);
+    while ((p = headProcQ(&edfQueue)) != NULL && !timeBefore(now, p->p_rtDeadline)) {
+        outProcQ(&edfQueue, p);
+        ++deadlineMisses;
+        releaseJob(p, now);
+        edfEnqueue(p);
+    }
+
+    p = removeProcQ(&edfQueue);
+    if (p != NULL) {
+        *quantum = p->p_rtLeft;
+    }
+
+    return p;
+}
+
+/*
+ * Direct handoff to p (see handoffScheduler)
+ * a real-time process is taken out of the EDF queue unless a ready one has an earlier deadline,
+ * a process of the scheduling policy unless a real-time process is ready
+ * returns 1 if p can be dispatched (with the given quantum), 0 otherwise
+ */
+int edfHandoff(pcb_t* p, unsigned int* quantum)
+{
+    pcb_t* first = headProcQ(&edfQueue);
+
+    if (p->p_queue == &edfQueue) {
+        if (timeBefore(first->p_rtDeadline, p->p_rtDeadline)) {
+            return 0;
+        }
+
+        outProcQ(&edfQueue, p);
+        *quantum = p->p_rtLeft;
+        return 1;
+    }
+
+    if (first != NULL) {
+        return 0;
+    }
+
+    return schedHandoff(p, quantum);
+}
+
+/*
+ * Checks if the process made ready should take the CPU from the running one:
+ * a real-time process in the EDF queue beats a process of the scheduling policy
+ * and a real-time process with a later deadline, otherwise the policy decides
+ */
+int edfPreempts(pcb_t* p, pcb_t* curr)
+{
+    int ready = p->p_queue == &edfQueue;
+    /* the running process has been dispatched by edfPick if it has budget left */
+    int running = curr->p_rtPeriod != 0 && curr->p_rtLeft > 0;
+
+    if (ready && running) {
+        return timeBefore(p->p_rtDeadline, curr->p_rtDeadline);
+    } else if (ready || running) {
+        return ready;
+    }
+
+    return schedPreempts(p, curr);
+}
+
+/*
+ * Charge the used cpu time to the budget of the current job
+ */
+void edfCharge(pcb_t* p, cpu_t time)
+{
+    if (p->p_rtPeriod != 0) {
+        p->p_rtLeft = (unsigned int) time < p->p_rtLeft ? p->p_rtLeft - time : 0;
+    }
+}
+
+/*
+ * The process completed its current job (it's waiting for the next period)
+ */
+void edfJobDone(pcb_t* p)
+{
+    if (p->p_rtPeriod == 0) {
+        return;
+    }
+
+    /* a job completed after its deadline is a miss too */
+    updateJob(p);
+    p->p_rtDone = 1;
+}
@@ -9,7 +9,9 @@
 #include "phase2/interrupts.h"
 #include "phase2/syscalls.h"
 #include "phase2/helpers.h"
+#include "phase2/smp.h"
 #include "phase2/variables.h"
+#include "phase1/pcb.h"
 
 /*
  * Kernel Exception Handler
@@ -18,43 +20,109 @@
  */
 void exceptionHandler()
 {
-#ifdef DEBUG
-    static unsigned int bpExcCode;
-    bpExcCode = CAUSE_GET_EXCCODE(((state_t*) PROCESSORSTATE0)->cause);
-    (void) bpExcCode;
-#endif
+    kernelLock();
+    /* drop the translations invalidated on the other processors (see tlbShootdownStart) */
+    tlbSync();
 
     /*
      * get processor state at the time of the exception
-     * (stored at the start of the BIOS Data Page)
+     * (stored by the BIOS in the BIOS Data Page, one for each processor)
      */
-    state_t* processorState = (state_t*) PROCESSORSTATE0;
-
-    switch (CAUSE_GET_EXCCODE(processorState->cause)) {
-        case EXC_INT:
-            interruptExceptionHandler(processorState);
-            break;
-        case EXC_SYS:
-            syscallExceptionHandler(processorState);
-            break;
-        case EXC_MOD:
-        case EXC_TLBL:
-        case EXC_TLBS:
-            passUpOrDie(processorState, PGFAULTEXCEPT);
-            break;
-        case EXC_ADEL:
-        case EXC_ADES:
-        case EXC_IBE:
-        case EXC_DBE:
-        case EXC_BP:
-        case EXC_RI:
-        case EXC_CPU:
-        case EXC_OV:
-            passUpOrDie(processorState, GENERALEXCEPT);
-            break;
-        default:
-            break;
+    state_t* processorState = (state_t*) PROCESSORSTATE(CPUID());
+
+    /*
+     * the interrupted process has been killed from another processor
+     * while it was running here (see kill): its PCB can be freed now
+     * (the interrupt handler already deals with no current process)
+     */
+    if (currentProcess != NULL && currentProcess->p_dying) {
+        freePcb(currentProcess);
+        currentProcess = NULL;
     }
+    if (currentProcess == NULL && CAUSE_GET_EXCCODE(processorState->cause) != EXC_INT) {
+        scheduler();
+    }
+
+    exceptionDispatch(processorState);
+}
+
+/* number of exception codes (ExcCode field of the cause register) */
+#define EXCCODES ((CAUSE_EXCCODE_MASK >> CAUSE_EXCCODE_BIT) + 1)
+
+HIDDEN void pageFaultHandler(state_t* pstate);
+HIDDEN void programTrapHandler(state_t* pstate);
+HIDDEN void ignoredExceptionHandler(state_t* pstate);
+
+/* exception vector: handler of each exception code */
+HIDDEN exc_handler_t excHandlers[EXCCODES];
+
+/*
+ * Fill the exception vector with the kernel handlers
+ */
+void exceptionsInit()
+{
+    for (unsigned int code = 0; code < EXCCODES; ++code) {
+        excHandlers[code] = ignoredExceptionHandler;
+    }
+
+    excHandlers[EXC_INT] = interruptExceptionHandler;
+    excHandlers[EXC_SYS] = syscallExceptionHandler;
+
+    excHandlers[EXC_MOD] = excHandlers[EXC_TLBL] = excHandlers[EXC_TLBS] = pageFaultHandler;
+
+    excHandlers[EXC_ADEL] = excHandlers[EXC_ADES] = programTrapHandler;
+    excHandlers[EXC_IBE] = excHandlers[EXC_DBE] = programTrapHandler;
+    excHandlers[EXC_BP] = excHandlers[EXC_RI] = programTrapHandler;
+    excHandlers[EXC_CPU] = excHandlers[EXC_OV] = programTrapHandler;
+}
+
+/*
+ * Register the handler of an exception code (replacing the kernel one)
+ */
+void setExceptionHandler(unsigned int excCode, exc_handler_t handler)
+{
+    if (excCode < EXCCODES) {
+        excHandlers[excCode] = handler;
+    }
+}
+
+/*
+ * Dispatch on the cause of the exception, through the exception vector
+ * (called with the kernel lock)
+ */
+void exceptionDispatch(state_t* processorState)
+{
+#ifdef DEBUG
+    static unsigned int bpExcCode;
+    bpExcCode = CAUSE_GET_EXCCODE(processorState->cause);
+    (void) bpExcCode;
+#endif
+
+    excHandlers[CAUSE_GET_EXCCODE(processorState->cause)](processorState);
+}
+
+/*
+ * TLB exceptions
+ */
+HIDDEN void pageFaultHandler(state_t* pstate)
+{
+    passUpOrDie(pstate, PGFAULTEXCEPT);
+}
+
+/*
+ * Program traps
+ */
+HIDDEN void programTrapHandler(state_t* pstate)
+{
+    passUpOrDie(pstate, GENERALEXCEPT);
+}
+
+/*
+ * Exception codes without a handler (reserved)
+ */
+HIDDEN void ignoredExceptionHandler(state_t* pstate)
+{
+    (void) pstate;
 }
 
 /*
@@ -75,12 +143,31 @@ void passUpOrDie(state_t* pstate, unsigned int excType)
     }
 
     /* save exception state into a location accessible to the support level (phase 3) */
-    memcpy(&currentProcess->p_supportStruct->sup_exceptState[excType], pstate, sizeof(state_t));
+    stateCopy(&currentProcess->p_supportStruct->sup_exceptState[excType], pstate);
+
+    /*
+     * the support level handler is entered with the support struct in a0
+     * and the exception type in a1, as its arguments: it doesn't need to ask
+     * the kernel for them (GETSUPPORTPTR), which would be a second trap
+     * LDCXT only loads sp, status and pc (a0-a3 carry its own arguments),
+     * so the context is loaded as a whole processor state, from this kernel stack
+     * (entry_hi keeps the ASID of the process, for its page tables)
+     */
+    support_t* psupport = currentProcess->p_supportStruct;
+    context_t* context = &psupport->sup_exceptContext[excType];
+    state_t contextState;
+
+    stateClear(&contextState);
+    contextState.reg_sp = context->stackPtr;
+    contextState.status = context->status;
+    contextState.pc_epc = contextState.reg_t9 = context->pc;
+    contextState.reg_a0 = (memaddr) psupport;
+    contextState.reg_a1 = excType;
+    contextState.entry_hi = pstate->entry_hi;
+
+    /* the support struct outlives the process, it can be read without the kernel lock */
+    kernelUnlock();
 
     /* load new context */
-    LDCXT(
-        currentProcess->p_supportStruct->sup_exceptContext[excType].stackPtr,
-        currentProcess->p_supportStruct->sup_exceptContext[excType].status,
-        currentProcess->p_supportStruct->sup_exceptContext[excType].pc
-    );
+    LDST(&contextState);
 }
@@ -0,0 +1,336 @@
+#include "pandos_types.h"
+#include "pandos_const.h"
+
+#include "phase2/scheduler.h"
+#include "phase2/variables.h"
+#include "phase1/pcb.h"
+
+/*
+ * Fair-share scheduling policy (built with -DSCHED_FAIR)
+ * the ready processes are kept in a tree ordered by virtual runtime
+ * (a treap: binary search tree on p_vruntime, max-heap on p_treeRank)
+ * and the one with the smallest virtual runtime is dispatched
+ */
+#ifdef SCHED_FAIR
+
+/* root and leftmost node (smallest virtual runtime) of the ready tree */
+HIDDEN pcb_t* treeRoot;
+HIDDEN pcb_t* treeFirst;
+/* p_queue of the processes in the tree (it's never used as a list) */
+HIDDEN list_head_t treeMarker;
+/*
+ * processes woken up all at once (see semWakeupAll),
+ * moved in the tree on the next dispatch
+ */
+HIDDEN list_head_t wakeQueue;
+
+/* sum of the weights of the processes in the tree */
+HIDDEN unsigned int treeWeight;
+/* lower bound of the virtual runtime of the ready processes (never decreases) */
+HIDDEN unsigned int minVruntime;
+/* state of the generator of the treap ranks */
+HIDDEN unsigned int rankSeed;
+
+/*
+ * Virtual runtime comparison, robust to the wraparound of the counters
+ */
+HIDDEN inline int vruntimeBefore(unsigned int a, unsigned int b)
+{
+    return (int) (a - b) < 0;
+}
+
+/*
+ * xorshift pseudo-random generator (the treap only needs ranks spread enough)
+ */
+HIDDEN inline unsigned int nextRank()
+{
+    rankSeed ^= rankSeed << 13;
+    rankSeed ^= rankSeed >> 17;
+    rankSeed ^= rankSeed << 5;
+    return rankSeed;
+}
+
+/*
+ * Replace the child old of parent with child (parent NULL means the root)
+ */
+HIDDEN inline void replaceChild(pcb_t* parent, pcb_t* old, pcb_t* child)
+{
+    if (parent == NULL) {
+        treeRoot = child;
+    } else if (parent->p_treeLeft == old) {
+        parent->p_treeLeft = child;
+    } else {
+        parent->p_treeRight = child;
+    }
+
+    if (child != NULL) {
+        child->p_treeUp = parent;
+    }
+}
+
+/*
+ * Rotate the node p above its parent (the in-order sequence doesn't change)
+ */
+HIDDEN void rotateUp(pcb_t* p)
+{
+    pcb_t* parent = p->p_treeUp;
+    replaceChild(parent->p_treeUp, parent, p);
+
+    if (parent->p_treeLeft == p) {
+        parent->p_treeLeft = p->p_treeRight;
+        if (p->p_treeRight != NULL) {
+            p->p_treeRight->p_treeUp = parent;
+        }
+        p->p_treeRight = parent;
+    } else {
+        parent->p_treeRight = p->p_treeLeft;
+        if (p->p_treeLeft != NULL) {
+            p->p_treeLeft->p_treeUp = parent;
+        }
+        p->p_treeLeft = parent;
+    }
+    parent->p_treeUp = p;
+}
+
+/*
+ * Insert the process in the tree
+ * processes with the same virtual runtime are kept in FIFO order (ties go right)
+ */
+HIDDEN void treeInsert(pcb_t* p)
+{
+    pcb_t* parent = NULL;
+    pcb_t** link = &treeRoot;
+    int leftmost = 1;
+
+    while (*link != NULL) {
+        parent = *link;
+        if (vruntimeBefore(p->p_vruntime, parent->p_vruntime)) {
+            link = &parent->p_treeLeft;
+        } else {
+            link = &parent->p_treeRight;
+            leftmost = 0;
+        }
+    }
+
+    p->p_treeLeft = p->p_treeRight = NULL;
+    p->p_treeUp = parent;
+    p->p_treeRank = nextRank();
+    *link = p;
+
+    /* restore the heap property on the ranks */
+    while (p->p_treeUp != NULL && p->p_treeUp->p_treeRank < p->p_treeRank) {
+        rotateUp(p);
+    }
+
+    if (leftmost) {
+        treeFirst = p;
+    }
+
+    p->p_queue = &treeMarker;
+    treeWeight += FAIR_WEIGHT(p->p_prio);
+}
+
+/*
+ * Remove the process from the tree
+ */
+HIDDEN void treeRemove(pcb_t* p)
+{
+    if (p == treeFirst) {
+        /* the leftmost node has no left child: the next one is in its right subtree or is its parent */
+        pcb_t* next = p->p_treeRight;
+        if (next != NULL) {
+            while (next->p_treeLeft != NULL) {
+                next = next->p_treeLeft;
+            }
+        } else {
+            next = p->p_treeUp;
+        }
+        treeFirst = next;
+    }
+
+    /* push the node down to a leaf (rotating up its child with the higher rank), then unlink it */
+    while (p->p_treeLeft != NULL && p->p_treeRight != NULL) {
+        if (p->p_treeLeft->p_treeRank > p->p_treeRight->p_treeRank) {
+            rotateUp(p->p_treeLeft);
+        } else {
+            rotateUp(p->p_treeRight);
+        }
+    }
+    replaceChild(p->p_treeUp, p, p->p_treeLeft != NULL ? p->p_treeLeft : p->p_treeRight);
+
+    p->p_queue = NULL;
+    treeWeight -= FAIR_WEIGHT(p->p_prio);
+}
+
+void schedInit()
+{
+    treeRoot = treeFirst = NULL;
+    mkEmptyProcQ(&treeMarker);
+    mkEmptyProcQ(&wakeQueue);
+    treeWeight = 0;
+    minVruntime = 0;
+    rankSeed = 0x9E3779B9;
+}
+
+/*
+ * a process that has been sleeping doesn't get more than FAIR_WAKEUP_CREDIT
+ * of advantage over the others (it would monopolize the CPU otherwise)
+ */
+void schedEnqueue(pcb_t* p)
+{
+    if (vruntimeBefore(p->p_vruntime, minVruntime - FAIR_WAKEUP_CREDIT)) {
+        p->p_vruntime = minVruntime - FAIR_WAKEUP_CREDIT;
+    }
+
+    treeInsert(p);
+}
+
+void schedDequeue(pcb_t* p)
+{
+    if (p->p_queue == &treeMarker) {
+        treeRemove(p);
+    } else if (p->p_queue == &wakeQueue) {
+        outProcQ(&wakeQueue, p);
+    }
+}
+
+int schedIsQueued(const pcb_t* p)
+{
+    return p->p_queue == &treeMarker || p->p_queue == &wakeQueue;
+}
+
+/*
+ * the woken processes are spliced in the wake queue at once,
+ * they are moved in the tree on the next dispatch
+ */
+list_head_t* schedWakeQueue(pcb_t* p)
+{
+    (void) p;
+    return &wakeQueue;
+}
+
+/*
+ * Move the processes woken up all at once in the tree
+ */
+HIDDEN void drainWakeQueue()
+{
+    pcb_t* p;
+    while ((p = removeProcQ(&wakeQueue)) != NULL) {
+        schedEnqueue(p);
+    }
+}
+
+/*
+ * Take p out of the tree to dispatch it, for its share of FAIR_LATENCY
+ */
+HIDDEN void takeOut(pcb_t* p, unsigned int* quantum)
+{
+    unsigned int weight = FAIR_WEIGHT(p->p_prio);
+    unsigned int totalWeight = treeWeight;
+    /* the smallest virtual runtime of the ready processes (p, unless it's a handoff) */
+    unsigned int first = treeFirst->p_vruntime;
+    treeRemove(p);
+
+    if (vruntimeBefore(minVruntime, first)) {
+        minVruntime = first;
+    }
+
+    *quantum = FAIR_LATENCY * weight / totalWeight;
+    if (*quantum < FAIR_MIN_GRANULARITY) {
+        *quantum = FAIR_MIN_GRANULARITY;
+    }
+}
+
+/*
+ * Dispatch the process with the smallest virtual runtime
+ * for its share of FAIR_LATENCY
+ */
+pcb_t* schedPick(unsigned int* quantum)
+{
+    drainWakeQueue();
+
+    pcb_t* p = treeFirst;
+    if (p == NULL) {
+        return NULL;
+    }
+
+    takeOut(p, quantum);
+    return p;
+}
+
+/*
+ * Direct handoff: p is dispatched right away, unless it's ahead
+ * of the first ready process by more than the minimum granularity
+ */
+int schedHandoff(pcb_t* p, unsigned int* quantum)
+{
+    drainWakeQueue();
+
+    if (p->p_queue != &treeMarker ||
+        vruntimeBefore(treeFirst->p_vruntime + FAIR_MIN_GRANULARITY, p->p_vruntime)) {
+        return 0;
+    }
+
+    takeOut(p, quantum);
+    return 1;
+}
+
+/*
+ * A process made ready takes the CPU from one that is ahead of it
+ * by more than the minimum granularity
+ */
+int schedPreempts(pcb_t* p, pcb_t* curr)
+{
+    return vruntimeBefore(p->p_vruntime + FAIR_MIN_GRANULARITY, curr->p_vruntime);
+}
+
+/*
+ * new processes start with the virtual runtime of the ready ones
+ */
+void schedNew(pcb_t* p)
+{
+    p->p_vruntime = minVruntime;
+}
+
+/*
+ * the virtual runtime grows slower for heavier (high priority) processes
+ * (a process already in the tree, e.g. after a yield, is moved to its new place)
+ */
+void schedCharge(pcb_t* p, cpu_t time)
+{
+    int queued = p->p_queue == &treeMarker;
+    if (queued) {
+        treeRemove(p);
+    }
+
+    p->p_vruntime += time * FAIR_WEIGHT_LOW / FAIR_WEIGHT(p->p_prio);
+
+    if (queued) {
+        treeInsert(p);
+    }
+}
+
+void schedPreempted(pcb_t* p)
+{
+    /* the virtual runtime already accounts for the used quantum */
+    (void) p;
+}
+
+void schedIoBlocked(pcb_t* p)
+{
+    /* sleeping processes are favoured by their (lower) virtual runtime already */
+    (void) p;
+}
+
+/*
+ * the process goes right after the first ready one
+ * (otherwise it would probably be scheduled again)
+ */
+void schedYield(pcb_t* p)
+{
+    if (treeFirst != NULL && vruntimeBefore(p->p_vruntime, treeFirst->p_vruntime)) {
+        p->p_vruntime = treeFirst->p_vruntime;
+    }
+}
+
+#endif
@@ -0,0 +1,226 @@
+#include <umps/libumps.h>
+#include "pandos_types.h"
+#include "pandos_const.h"
+
+#include "phase2/groups.h"
+#include "phase2/timers.h"
+#include "phase2/helpers.h"
+#include "phase1/pcb.h"
+
+/*
+ * Process groups with a CPU bandwidth quota (e.g. one group per tenant)
+ * a process is in the group of its creator (group 0, with no quota, by default)
+ * and can move to another one with SETGROUP; all the cpu time used by the
+ * processes of a group is charged to it, and once the group used its quota
+ * in the current period it's throttled: its processes aren't dispatched
+ * (the ready ones are parked in the group) up to the refill, at the end of the period
+ *
+ * a period starts when the group is charged without a period in progress,
+ * so an idle group has no refill timer armed (see timers.c)
+ */
+
+HIDDEN group_t groups[MAXGROUPS];
+/* processes parked in all the groups */
+HIDDEN unsigned int parkedCount;
+
+HIDDEN void groupRefill(ktimer_t* t);
+
+HIDDEN inline group_t* groupOf(const pcb_t* p)
+{
+    return &groups[p->p_group];
+}
+
+void groupsInit()
+{
+    for (unsigned int g = 0; g < MAXGROUPS; ++g) {
+        groups[g].g_quota = 0;
+        groups[g].g_used = 0;
+        groups[g].g_throttled = 0;
+        mkEmptyProcQ(&groups[g].g_parked);
+        groups[g].g_refill.t_link.next = NULL;
+        groups[g].g_refill.t_handler = groupRefill;
+        groups[g].g_usage = 0;
+        groups[g].g_throttles = 0;
+    }
+
+    parkedCount = 0;
+}
+
+/*
+ * Give the parked processes back to the ready queues
+ */
+HIDDEN void unthrottle(group_t* g)
+{
+    g->g_throttled = 0;
+
+    pcb_t* p;
+    while ((p = removeProcQ(&g->g_parked)) != NULL) {
+        --parkedCount;
+        insertPrioProcQ(p);
+    }
+}
+
+/*
+ * End of the period of a group (a kernel timer):
+ * the quota is given back, less what was used beyond it
+ */
+HIDDEN void groupRefill(ktimer_t* t)
+{
+    group_t* g = container_of(t, group_t, g_refill);
+
+    g->g_used = g->g_used > g->g_quota ? g->g_used - g->g_quota : 0;
+
+    if (g->g_used < g->g_quota) {
+        unthrottle(g);
+    } else {
+        /* still over the quota, one more period */
+        cpu_t now;
+        STCK(now);
+        timerArm(t, now + g->g_period);
+    }
+}
+
+/*
+ * Move p to the given group (its cpu time from now on is charged to it)
+ * returns 0 on success, -1 if the group doesn't exist
+ */
+int groupJoin(pcb_t* p, unsigned int group)
+{
+    if (group >= MAXGROUPS) {
+        return -1;
+    }
+
+    p->p_group = group;
+    return 0;
+}
+
+/*
+ * Set the quota of the group: quota us of cpu time every period us,
+ * a zero quota removes the limit (group 0 has none)
+ * returns 0 on success, -1 if the request is not valid
+ */
+int groupSetQuota(unsigned int group, unsigned int quota, unsigned int period)
+{
+    if (group == 0 || group >= MAXGROUPS) {
+        return -1;
+    }
+
+    group_t* g = &groups[group];
+
+    if (quota == 0) {
+        g->g_quota = 0;
+        g->g_used = 0;
+        timerCancel(&g->g_refill);
+        unthrottle(g);
+        return 0;
+    }
+
+    if (period == 0 || period > GROUP_MAX_PERIOD || quota > period) {
+        return -1;
+    }
+
+    /* the new quota applies from the next period */
+    g->g_quota = quota;
+    g->g_period = period;
+
+    return 0;
+}
+
+/*
+ * Called when p is made ready: if its group is throttled p is parked
+ * in the group up to the refill, instead of joining the ready queues
+ * returns 1 if p has been parked
+ */
+int groupPark(pcb_t* p)
+{
+    group_t* g = groupOf(p);
+
+    if (!g->g_throttled) {
+        return 0;
+    }
+
+    insertProcQ(&g->g_parked, p);
+    ++parkedCount;
+    return 1;
+}
+
+/*
+ * Remove p from the parked processes of its group, if it's in there
+ * returns 1 if it was parked
+ */
+int groupDequeue(pcb_t* p)
+{
+    if (outProcQ(&groupOf(p)->g_parked, p) == NULL) {
+        return 0;
+    }
+
+    --parkedCount;
+    return 1;
+}
+
+/*
+ * Number of processes parked in the groups: they're going to be ready
+ * at the refill, so with no ready process the system is not deadlocked
+ */
+unsigned int groupsParked()
+{
+    return parkedCount;
+}
+
+/*
+ * Charge the cpu time used by p to its group
+ * (it's throttled once it used up its quota)
+ */
+void groupCharge(pcb_t* p, cpu_t time)
+{
+    group_t* g = groupOf(p);
+
+    g->g_usage += time;
+
+    if (g->g_quota == 0) {
+        return;
+    }
+
+    /* the first charge without a period in progress starts a new one */
+    if (!timerArmed(&g->g_refill)) {
+        cpu_t now;
+        STCK(now);
+        timerArm(&g->g_refill, now - time + g->g_period);
+    }
+
+    g->g_used += time;
+    if (!g->g_throttled && g->g_used >= g->g_quota) {
+        g->g_throttled = 1;
+        ++g->g_throttles;
+    }
+}
+
+/*
+ * Quantum of p, cut down to what's left of the quota of its group
+ * (so a group doesn't go beyond its quota by up to a whole quantum)
+ */
+unsigned int groupQuantum(const pcb_t* p, unsigned int quantum)
+{
+    group_t* g = groupOf(p);
+
+    if (g->g_quota == 0 || g->g_used >= g->g_quota) {
+        return quantum;
+    }
+
+    unsigned int left = g->g_quota - g->g_used;
+    return left < quantum ? left : quantum;
+}
+
+/*
+ * Usage counters of a group: total cpu time used (us, -1 if the group
+ * doesn't exist) and times it has been throttled
+ */
+int groupUsage(unsigned int group)
+{
+    return group < MAXGROUPS ? (int) groups[group].g_usage : -1;
+}
+
+unsigned int groupThrottles(unsigned int group)
+{
+    return group < MAXGROUPS ? groups[group].g_throttles : 0;
+}
@@ -6,88 +6,110 @@
 
 #include "phase2/exceptions.h"
 #include "phase2/scheduler.h"
+#include "phase2/edf.h"
+#include "phase2/groups.h"
+#include "phase2/timers.h"
 #include "phase2/helpers.h"
 #include "phase2/variables.h"
 #include "phase1/pcb.h"
 #include "phase1/asl.h"
 
-extern cpu_t schedulingTime;
+extern cpu_t schedulingTimes[NCPU];
 
 /*
- * Insert the process in the priority queue
+ * Make the process ready
+ * in the EDF queue if it's a real-time process with some budget left,
+ * in the ready queue of the scheduling policy otherwise
+ * (parked in its group up to the refill if the group used up its quota)
  */
 void insertPrioProcQ(pcb_t* p)
 {
-    if (p->p_prio == PROCESS_PRIO_LOW) {
-        insertProcQ(procQLow, p);
-    } else if (p->p_prio == PROCESS_PRIO_HIGH) {
-        insertProcQ(procQHigh, p);
-    } else {
-        /* this should never happen */
-        ;
+    if (groupPark(p)) {
+        return;
+    }
+
+    if (!edfEnqueue(p)) {
+        schedEnqueue(p);
     }
+    readyNotify(p);
 }
 
 /*
- * Remove the process from its priority queue
+ * Remove the process from the ready queue, if it's in there
  */
 void outPrioProcQ(pcb_t* p)
 {
-    if (p->p_prio == PROCESS_PRIO_LOW) {
-        outProcQ(procQLow, p);
-    } else if (p->p_prio == PROCESS_PRIO_HIGH) {
-        outProcQ(procQHigh, p);
+    if (!groupDequeue(p) && !edfDequeue(p)) {
+        schedDequeue(p);
+    }
+}
+
+/*
+ * Change the (effective) priority of the given process
+ * keeping it in the right place of the queue it's linked in:
+ * a ready process is requeued according to its new priority
+ * (a real-time process in the EDF queue keeps its place, ordered by deadline),
+ * a blocked process is reordered in the semd queue and,
+ * if that semd is owned, the priority is propagated to its owner
+ */
+void setPrio(pcb_t* p, int prio)
+{
+    if (p->p_prio == prio) {
+        return;
+    }
+
+    if (schedIsQueued(p)) {
+        outPrioProcQ(p);
+        p->p_prio = prio;
+        insertPrioProcQ(p);
+    } else if (p->p_semAdd != NULL) {
+        sem_t* semAddr = p->p_semAdd;
+
+        /* can't fail: the semd is freed by outBlocked just when it's reused */
+        outBlocked(p);
+        p->p_prio = prio;
+        insertBlocked(semAddr, p);
+
+        pcb_t* owner = getSemOwner(semAddr);
+        if (owner != NULL) {
+            updateInheritedPrio(owner);
+        }
     } else {
-        /* this should never happen */
-        ;
+        /* current process (or a process being killed) */
+        p->p_prio = prio;
     }
 }
 
+/*
+ * Priority inheritance
+ * the effective priority of a process is the highest between its own
+ * and the ones of the processes blocked on the semaphores (mutexes) it owns
+ */
+void updateInheritedPrio(pcb_t* p)
+{
+    int prio = ownedWaitersPrio(p);
+
+    setPrio(p, prio > p->p_basePrio ? prio : p->p_basePrio);
+}
+
 /*
  * Checks if the given semAddr is part of the allocated device semaphores
  */
 int isDeviceSemaphore(sem_t* semAddr)
 {
     return
-        (semAddr >= &devSems[0] && semAddr <= &devSems[(DEVINTNUM-1)*DEVPERINT]) ||
-        (semAddr >= &termSems[0][0] && semAddr <= &termSems[2][DEVPERINT]) ||
+        (semAddr >= &devSems[0] && semAddr < &devSems[(DEVINTNUM-1)*DEVPERINT]) ||
+        (semAddr >= &termSems[0][0] && semAddr < (sem_t*) termSems + 2 * DEVPERINT) ||
         semAddr == &pseudoClockSem;
 }
 
 /*
  * Find the pcb corresponding to the given pid
- * in all available process queues.
- * It seems inefficient but it's actually O(processCount)
+ * through the PID index kept by phase1 (O(1) on average)
  */
 pcb_t* findPcb(pid_t pid)
 {
-    pcb_t* currentPcb;
-    semd_t* currentSemd;
-
-    /* search the pcb in the queue of low priority processes */
-    list_for_each_entry(currentPcb, procQLow, p_list) {
-        if (currentPcb->p_pid == pid) {
-            return currentPcb;
-        }
-    }
-
-    /* search the pcb in the queue of high priority processes */
-    list_for_each_entry(currentPcb, procQHigh, p_list) {
-        if (currentPcb->p_pid == pid) {
-            return currentPcb;
-        }
-    }
-
-    /* search the pcb in the queue of active SEMDs */
-    list_for_each_entry(currentSemd, getSemdHead(), s_link) {
-        list_for_each_entry(currentPcb, &currentSemd->s_procq, p_list) {
-            if (currentPcb->p_pid == pid) {
-                return currentPcb;
-            }
-        }
-    }
-
-    return NULL;
+    return findPid(pid);
 }
 
 /*
@@ -117,11 +139,90 @@ pcb_t* semWakeup(sem_t* semAddr)
     return proc;
 }
 
+/*
+ * Wake up all the blocked processes on the given semd at once
+ * the whole semd queue is moved onto the ready queue(s) of the scheduling policy
+ * (real-time processes onto the EDF queue)
+ * returns the number of woken processes
+ */
+unsigned int semWakeupAll(sem_t* semAddr)
+{
+    pcb_t* owner = getSemOwner(semAddr);
+    /* the semd queue is ordered by priority: the first one is the best of the normal ones */
+    pcb_t* first = headBlocked(semAddr);
+    unsigned int n = removeAllBlocked(semAddr, edfWakeQueue);
+    edfWakeup();
+
+    if (first != NULL && first->p_rtPeriod == 0) {
+        readyNotify(first);
+    }
+
+    /* the owner no longer inherits the priority of the woken processes */
+    if (n > 0 && owner != NULL) {
+        updateInheritedPrio(owner);
+    }
+
+    return n;
+}
+
+/*
+ * Support function for kill
+ * remove the given process from the queue it's linked in (ready queue or semd)
+ * returns 1 if the process was soft-blocked, 0 otherwise
+ */
+HIDDEN int detachProcess(pcb_t* proc)
+{
+    /* if the process is blocked on a semaphore... */
+    if (proc->p_semAdd != NULL) {
+        /* check it before outBlocked clears p_semAdd */
+        int softBlocked = isDeviceSemaphore(proc->p_semAdd);
+        pcb_t* owner = getSemOwner(proc->p_semAdd);
+
+        /* remove it from the semd proc queue */
+        outBlocked(proc);
+
+        /* the owner of the semaphore may no longer inherit its priority */
+        if (owner != NULL) {
+            updateInheritedPrio(owner);
+        }
+
+        return softBlocked;
+    }
+
+    /* a sleeping process is soft-blocked on its own timer */
+    if (timerArmed(&proc->p_sleepTimer)) {
+        timerCancel(&proc->p_sleepTimer);
+        return 1;
+    }
+
+    /* remove proc from the ready queue (no effect on the current process) */
+    outPrioProcQ(proc);
+
+    return 0;
+}
+
+/*
+ * Whether p is the current process of a processor other than this one
+ */
+HIDDEN int isRunningElsewhere(pcb_t* p)
+{
+    for (unsigned int cpu = 0; cpu < NCPU; ++cpu) {
+        if (cpu != CPUID() && currentProcs[cpu] == p) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 /*
  * Terminate the given process and its progeny
  * a kill operation is frequent in a OS, because many times
  * the OS may prefer to kill a process instead
  * of trying to report an error
+ * the tree is walked iteratively (the kernel stack use doesn't depend
+ * on the shape of the tree): a process is moved on a local kill queue
+ * as soon as it's detached from its own queue, since p_list is free from then on
  */
 void kill(pcb_t* proc)
 {
@@ -129,43 +230,68 @@ void kill(pcb_t* proc)
         return;
     }
 
-    /* remove proc from its parent (if available) */
+    /* processes still to terminate, already detached from any queue */
+    list_head_t killQ;
+    mkEmptyProcQ(&killQ);
+
+    unsigned int killed = 0;
+    unsigned int softBlocked = 0;
+
+    /* detach the whole subtree from proc parent (if available) */
     outChild(proc);
 
-    /* if the process is blocked on a semaphore... */
-    if (proc->p_semAdd != NULL) {
-        /* remove it from the semd proc queue */
-        outBlocked(proc);
+    softBlocked += detachProcess(proc);
+    insertProcQ(&killQ, proc);
+
+    pcb_t* p;
+    while ((p = removeProcQ(&killQ)) != NULL) {
+        pcb_t* child;
 
-        /* if we are handling a device semaphore */
-        if (isDeviceSemaphore(proc->p_semAdd)) {
-            --softBlockCount;
+        /* every child joins the kill queue */
+        list_for_each_entry(child, &p->p_child, p_sib) {
+            softBlocked += detachProcess(child);
+            insertProcQ(&killQ, child);
         }
-    } else {
-        /* remove proc from the ready queue */
-        outPrioProcQ(proc);
-    }
 
-    --processCount;
+        /* the mutexes owned by p are left without owner */
+        disownSems(p);
+        /* and its utilization is given back to the real-time class */
+        edfLeave(p);
 
-    /* terminate every proc child */
-    while (!emptyChild(proc)) {
-        kill(removeChild(proc));
-    }
+        ++killed;
+
+        /*
+         * a process running on another processor keeps running until its
+         * next exception at most, and that processor reads its PCB outside
+         * the kernel lock (e.g. uTLB_RefillHandler): the PCB is only marked
+         * as dying, out of the PID index, and that processor frees it
+         * when it gets back to the kernel (see exceptionHandler)
+         */
+        if (isRunningElsewhere(p)) {
+            p->p_dying = 1;
+            removePid(p);
+            continue;
+        }
+
+        /* flag that the current process (if p) ceased to exist */
+        if (currentProcess == p) {
+            currentProcess = NULL;
+        }
 
-    /* flag that current process ceased to exist */
-    if (currentProcess == proc) {
-        currentProcess = NULL;
+        freePcb(p);
     }
 
-    freePcb(proc);
+    /* fix up the kernel counters once for the whole subtree */
+    processCount -= killed;
+    softBlockCount -= softBlocked;
 }
 
 void generateException(unsigned int excCode)
 {
-    ((state_t*) PROCESSORSTATE0)->status &=
+    ((state_t*) PROCESSORSTATE(CPUID()))->status &=
         ~CAUSE_EXCCODE_MASK | (excCode << CAUSE_EXCCODE_BIT);
-    exceptionHandler();
+    /* already in the kernel (with the kernel lock) */
+    exceptionDispatch((state_t*) PROCESSORSTATE(CPUID()));
 }
 
 /*
@@ -177,7 +303,11 @@ void updateCpuTime()
     cpu_t currentTime; 
     STCK(currentTime); 
 
-    currentProcess->p_time += currentTime - schedulingTime;
+    cpu_t used = currentTime - schedulingTimes[CPUID()];
+    currentProcess->p_time += used;
+    schedCharge(currentProcess, used);
+    edfCharge(currentProcess, used);
+    groupCharge(currentProcess, used);
 
-    STCK(schedulingTime); 
+    STCK(schedulingTimes[CPUID()]);
 }
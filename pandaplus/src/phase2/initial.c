@@ -1,22 +1,30 @@
+#include <umps/libumps.h>
 #include "pandos_types.h"
 #include "pandos_const.h"
+#include "utils.h"
 
 #include "phase2/exceptions.h"
+#include "phase2/interrupts.h"
 #include "phase2/scheduler.h"
+#include "phase2/edf.h"
+#include "phase2/groups.h"
+#include "phase2/timers.h"
+#include "phase2/work.h"
+#include "phase2/smp.h"
 #include "phase2/helpers.h"
 #include "phase1/pcb.h"
 #include "phase1/asl.h"
+#include "phase1/slab.h"
 
 extern void test();
 extern void uTLB_RefillHandler();
 
-HIDDEN list_head_t procQLow_sentinel, procQHigh_sentinel;
-
 /* Kernel global variables (check phase2/variables.h) */
 unsigned int processCount, softBlockCount;
-pcb_t*       currentProcess;
-list_head_t* procQLow;
-list_head_t* procQHigh;
+pcb_t*       currentProcs[NCPU];
+unsigned int deadlineMisses;
+unsigned int interruptEntries, interruptsServiced;
+unsigned int workItems, workMaxDepth;
 sem_t        pseudoClockSem;
 sem_t        devSems[(DEVINTNUM-1)*DEVPERINT];
 sem_t        termSems[2][DEVPERINT];
@@ -24,28 +32,35 @@ int          forceLowQ;
 
 void main()
 {
-    /* Populate the Processor 0 Pass Up Vector */
-    passupvector_t* passUpVector = (passupvector_t*) PASSUPVECTOR;
-    passUpVector->tlb_refill_handler = (memaddr) uTLB_RefillHandler;
-    passUpVector->tlb_refill_stackPtr = (memaddr) KERNELSTACK;
-    passUpVector->exception_handler = (memaddr) exceptionHandler;
-    passUpVector->exception_stackPtr= (memaddr) KERNELSTACK;
+    /* Populate the Pass Up Vector of each processor, with its own kernel stack */
+    for (unsigned int cpu = 0; cpu < NCPU; ++cpu) {
+        passupvector_t* passUpVector = (passupvector_t*) CPUPASSUPVECTOR(cpu);
+        passUpVector->tlb_refill_handler = (memaddr) uTLB_RefillHandler;
+        passUpVector->tlb_refill_stackPtr = (memaddr) CPUSTACK(cpu);
+        passUpVector->exception_handler = (memaddr) exceptionHandler;
+        passUpVector->exception_stackPtr= (memaddr) CPUSTACK(cpu);
+    }
+
+    /* the kernel runs holding the kernel lock (released when a process is dispatched) */
+    kernelLock();
 
     /* Initialize phase1 data structures */
+    initSlabs();
     initPcbs();
 	initASL();
 
     /* Initialize all kernel maintained variables */
     processCount = 0;
     softBlockCount = 0;
-    currentProcess = NULL;
-
-    procQLow = &procQLow_sentinel;
-    mkEmptyProcQ(procQLow);
-    procQHigh = &procQHigh_sentinel;
-    mkEmptyProcQ(procQHigh);
+    for (unsigned int cpu = 0; cpu < NCPU; ++cpu) {
+        currentProcs[cpu] = NULL;
+    }
 
+    interruptEntries = interruptsServiced = 0;
     forceLowQ = 0; /* false */
+    schedInit();
+    edfInit();
+    groupsInit();
 
     pseudoClockSem = 0;
 	for (size_t i = 0; i < (DEVINTNUM-1)*DEVPERINT; ++i) {
@@ -55,13 +70,23 @@ void main()
         *((sem_t*)termSems + i) = 0;
     }
 
-    /* Load the system-wide Interval Timer (used in NSYS7) */
-    LDIT(PSECOND);
+    /* Kernel timers on the system-wide Interval Timer (e.g. the pseudo-clock of NSYS7) */
+    timersInit();
+
+    /* Deferred work of the interrupts, exception and interrupt vectors */
+    workInit();
+    exceptionsInit();
+    interruptsInit();
 
     /* First process setup */
     pcb_t* proc = allocPcb();
+    /* with PCB_LAZY_INIT allocPcb leaves the state dirty and we only set some registers */
+    stateClear(&proc->p_s);
     proc->p_pid = 1;
-    proc->p_prio = PROCESS_PRIO_LOW;
+    proc->p_supportStruct = NULL;
+    insertPid(proc);
+    proc->p_prio = proc->p_basePrio = PROCESS_PRIO_LOW;
+    schedNew(proc);
     proc->p_s.status = TEBITON | IMON | IEPON; /* PLT, INTERRUPTS, KERNEL MODE */
     proc->p_s.pc_epc = proc->p_s.reg_t9 = (memaddr) test;
     RAMTOP(proc->p_s.reg_sp); /* SP set to last RAM frame */
@@ -69,6 +94,9 @@ void main()
     insertPrioProcQ(proc);
     ++processCount;
 
+    /* Start the other processors (they wait for the kernel lock) */
+    smpInit();
+
     /* Call the Scheduler */
     scheduler();
 }
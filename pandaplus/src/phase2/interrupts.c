@@ -6,7 +6,10 @@
 
 #include "phase2/interrupts.h"
 #include "phase2/scheduler.h"
+#include "phase2/timers.h"
+#include "phase2/work.h"
 #include "phase2/helpers.h"
+#include "phase2/smp.h"
 #include "phase2/variables.h"
 #include "phase1/pcb.h"
 
@@ -15,46 +18,131 @@
 HIDDEN void returnFromIntException();
 
 HIDDEN void pltInterruptHandler();
-HIDDEN void itInterruptHandler();
-HIDDEN void deviceInterruptHandler(unsigned int deviceLineNo);
-HIDDEN void terminalInterruptHandler();
+HIDDEN void itInterruptHandler(unsigned int line);
+HIDDEN void deviceLineHandler(unsigned int line);
+HIDDEN void ignoredLineHandler(unsigned int line);
+HIDDEN void deviceInterruptHandler(unsigned int deviceLineNo, unsigned int deviceNo);
+HIDDEN void terminalInterruptHandler(unsigned int line, unsigned int terminalNo);
+HIDDEN void terminalSubDeviceHandler(devregf_t* statusReg, devregf_t* commandReg, work_t* work);
+HIDDEN void timersWorkHandler(work_t* w);
+HIDDEN void ioCompletionWorkHandler(work_t* w);
 
 extern cpu_t startingTime;
 
+HIDDEN void pseudoClockTick(ktimer_t* t);
+
+/* pseudo-clock, armed just while there are processes waiting for it */
+HIDDEN ktimer_t pseudoClockTimer = { .t_link = { NULL, NULL }, .t_handler = pseudoClockTick };
+
+/* interrupt vectors: handler of each interrupt line, and of each device of the device lines */
+HIDDEN line_handler_t lineHandlers[N_INTERRUPT_LINES];
+HIDDEN dev_handler_t  devHandlers[N_EXT_IL][N_DEV_PER_IL];
+
+/*
+ * deferred work (bottom halves) of the interrupts: the kernel timers,
+ * the I/O completion of each device and of each terminal sub-device
+ * (0 = transmitter / 1 = receiver); a device can't interrupt again
+ * before the process waiting for it issues a new I/O, so one item each is enough
+ */
+HIDDEN work_t timersWork;
+HIDDEN work_t devWork[DEVINTNUM-1][DEVPERINT];
+HIDDEN work_t termWork[2][DEVPERINT];
+
+/*
+ * Fill the interrupt vectors with the kernel handlers
+ * (the PLT line is served apart, see interruptExceptionHandler)
+ */
+void interruptsInit()
+{
+    timersWork.w_link.next = timersWork.w_link.prev = NULL;
+    timersWork.w_handler = timersWorkHandler;
+
+    for (unsigned int i = 0; i < (DEVINTNUM-1)*DEVPERINT; ++i) {
+        work_t* w = (work_t*) devWork + i;
+        w->w_link.next = w->w_link.prev = NULL;
+        w->w_handler = ioCompletionWorkHandler;
+        w->w_sem = &devSems[i];
+    }
+    for (unsigned int sub = 0; sub < 2; ++sub) {
+        for (unsigned int dev = 0; dev < DEVPERINT; ++dev) {
+            work_t* w = &termWork[sub][dev];
+            w->w_link.next = w->w_link.prev = NULL;
+            w->w_handler = ioCompletionWorkHandler;
+            w->w_sem = &termSems[sub][dev];
+        }
+    }
+
+    lineHandlers[IL_IPI] = lineHandlers[IL_CPUTIMER] = ignoredLineHandler;
+    lineHandlers[IL_TIMER] = itInterruptHandler;
+
+    for (unsigned int line = DEV_IL_START; line < N_INTERRUPT_LINES; ++line) {
+        lineHandlers[line] = deviceLineHandler;
+        for (unsigned int dev = 0; dev < N_DEV_PER_IL; ++dev) {
+            devHandlers[EXT_IL_INDEX(line)][dev] = line == TERMINT ? terminalInterruptHandler : deviceInterruptHandler;
+        }
+    }
+}
+
+/*
+ * Register the handler of an interrupt line (replacing the kernel one)
+ */
+void setLineHandler(unsigned int line, line_handler_t handler)
+{
+    if (line != IL_CPUTIMER && line < N_INTERRUPT_LINES) {
+        lineHandlers[line] = handler;
+    }
+}
+
+/*
+ * Register the handler of a device (replacing the kernel one, e.g. a driver)
+ * it's called with the kernel lock and it has to ACK the device
+ */
+void setDeviceHandler(unsigned int line, unsigned int dev, dev_handler_t handler)
+{
+    if (line >= DEV_IL_START && line < N_INTERRUPT_LINES && dev < N_DEV_PER_IL) {
+        devHandlers[EXT_IL_INDEX(line)][dev] = handler;
+    }
+}
 
 /*
  * Interrupt Exception Handler
+ * all the pending interrupts are served in one exception entry, in priority order
+ * through the interrupt vectors:
+ * the interval timer, then every device with a pending interrupt of each device line
+ * (both sub-devices of a terminal), instead of just the highest priority one
+ * (the others would raise a new exception as soon as the processor goes back to the process)
+ * the handlers are top halves, they just ACK and queue their work (see work.c),
+ * run once every pending interrupt has been ACKed
+ * the PLT is served last since its handler doesn't return (context switch)
  */
 void interruptExceptionHandler(state_t* pstate)
 {
+    /* pending lines, including the ones raised since the exception has been taken */
+    unsigned int lines = (pstate->cause | getCAUSE()) & IMON;
+
 #ifdef DEBUG
     static unsigned int bpInterruptLine;
-    bpInterruptLine = lsb(pstate->cause & IMON) - 8;
+    bpInterruptLine = lsb(lines) - 8;
     (void) bpInterruptLine;
 #endif
 
-    switch (0x1 << lsb(pstate->cause & IMON)) {
-        case LOCALTIMERINT:
-            pltInterruptHandler();
-            break;
-        case TIMERINTERRUPT:
-            itInterruptHandler();
-            break;
-        case DISKINTERRUPT:
-            deviceInterruptHandler(DISKINT);
-            break;
-        case FLASHINTERRUPT:
-            deviceInterruptHandler(FLASHINT);
-            break;
-        case PRINTINTERRUPT:
-            deviceInterruptHandler(PRNTINT);
-            break;
-        case TERMINTERRUPT:
-            terminalInterruptHandler();
-            break;
-        default:
-            break;
+    ++interruptEntries;
+
+    /* pending lines but the PLT, scanned in priority order (lowest line first) */
+    for (unsigned int pending = (lines & ~LOCALTIMERINT) >> 8; pending != 0; pending &= pending - 1) {
+        unsigned int line = lsb(pending);
+        lineHandlers[line](line);
     }
+
+    /* every pending interrupt has been ACKed: bottom halves (wakeups, timers) */
+    workRun();
+
+    if (lines & LOCALTIMERINT) {
+        ++interruptsServiced;
+        pltInterruptHandler();
+    }
+
+    returnFromIntException();
 }
 
 HIDDEN void returnFromIntException()
@@ -68,7 +156,20 @@ HIDDEN void returnFromIntException()
         scheduler();
     }
 
-    LDST((state_t*) PROCESSORSTATE0);
+    /*
+     * wakeup preemption: the interrupt made ready a process that outranks
+     * the interrupted one (e.g. a high priority process waiting for an I/O),
+     * so it's dispatched right away instead of at the end of the current quantum
+     */
+    if (preemptPending()) {
+        stateCopy(&currentProcess->p_s, (state_t*) PROCESSORSTATE(CPUID()));
+        updateCpuTime();
+        insertPrioProcQ(currentProcess); /* deschedule, keeping its level */
+        scheduler();
+    }
+
+    kernelUnlock();
+    LDST((state_t*) PROCESSORSTATE(CPUID()));
 }
 
 /*
@@ -77,70 +178,139 @@ HIDDEN void returnFromIntException()
 HIDDEN void pltInterruptHandler()
 {
     setTIMER(0xFFFFFFFF); /* ACK */
-    /* preemption is applied only to low priority processes! */
-    insertProcQ(procQLow, currentProcess); /* deschedule */
+
+    /* idle poll (more processors), or the process has been killed from another processor */
+    if (currentProcess == NULL) {
+        scheduler();
+    }
 
     /* context switch */
-    memcpy(&currentProcess->p_s, (state_t*) PROCESSORSTATE0, sizeof(state_t));
+    stateCopy(&currentProcess->p_s, (state_t*) PROCESSORSTATE(CPUID()));
     updateCpuTime(); /* update accumulated processor time by the current process */
+
+    /*
+     * the process burnt its whole quantum (charged above, before requeueing it)
+     * for a real-time process that is the budget of its job: it's throttled,
+     * the scheduling policy runs it up to its next job, without demoting it
+     * (the budget says nothing about its behaviour in the policy)
+     */
+    if (currentProcess->p_rtPeriod == 0) {
+        schedPreempted(currentProcess);
+    }
+    insertPrioProcQ(currentProcess); /* deschedule */
     scheduler();
 }
 
-HIDDEN void itInterruptHandler()
+HIDDEN void itInterruptHandler(unsigned int line)
 {
-    LDIT(PSECOND); /* ACK */
+    (void) line;
+    ++interruptsServiced;
 
-    /* wake up all blocked processes on the pseudo clock semd */
-    while (semWakeup(&pseudoClockSem) != NULL) {
-        --softBlockCount;
+    /* ACK right away */
+    timersAck();
+
+    /* deferred: the timer handlers may do any amount of work */
+    workQueue(&timersWork);
+}
+
+/*
+ * Bottom half of the interval timer interrupt
+ */
+HIDDEN void timersWorkHandler(work_t* w)
+{
+    (void) w;
+
+    /* expired kernel timers (e.g. the pseudo-clock) and next expiry */
+    timersExpire();
+}
+
+/*
+ * Pseudo-clock tick (a kernel timer)
+ */
+HIDDEN void pseudoClockTick(ktimer_t* t)
+{
+    (void) t;
+
+    /* wake up all blocked processes on the pseudo clock semd (at once) */
+    softBlockCount -= semWakeupAll(&pseudoClockSem);
+}
+
+/*
+ * Make sure the pseudo-clock ticks for a process going to wait for it:
+ * the ticks are on the multiples of PSECOND since boot,
+ * but only the ones somebody is waiting for are taken
+ */
+void pseudoClockArm()
+{
+    if (timerArmed(&pseudoClockTimer)) {
+        return;
     }
 
-    returnFromIntException();
+    cpu_t now;
+    STCK(now);
+    timerArm(&pseudoClockTimer, ((unsigned int) now / PSECOND + 1) * PSECOND);
 }
 
-HIDDEN void deviceInterruptHandler(unsigned int deviceLineNo)
+/*
+ * Device line: every device with a pending interrupt, in priority order
+ */
+HIDDEN void deviceLineHandler(unsigned int line)
+{
+    /* the bitmap may be empty if another processor served them */
+    unsigned int bitmap = *((memaddr*) CDEV_BITMAP_ADDR(line));
+
+    for (; bitmap != 0; bitmap &= bitmap - 1) {
+        unsigned int dev = lsb(bitmap);
+        ++interruptsServiced;
+        devHandlers[EXT_IL_INDEX(line)][dev](line, dev);
+    }
+}
+
+/*
+ * Lines without a handler (inter-processor interrupts are not used)
+ */
+HIDDEN void ignoredLineHandler(unsigned int line)
+{
+    (void) line;
+}
+
+HIDDEN void deviceInterruptHandler(unsigned int deviceLineNo, unsigned int deviceNo)
 {
-    /* determine the device with a pending interrupt */
-    unsigned int deviceNo = lsb(*((memaddr*) CDEV_BITMAP_ADDR(deviceLineNo)));
     /* device register */
     dtpreg_t* devreg = (dtpreg_t*) DEV_REG_ADDR(deviceLineNo, deviceNo);
 
+    work_t* work = &devWork[EXT_IL_INDEX(deviceLineNo)][deviceNo];
+
     /* save off status field since after ACK it will be overwritten */
-    devregf_t status = devreg->status;
+    work->w_status = devreg->status;
     /* ACK the device interrupt */
     devreg->command = ACK;
-    /* wake up the blocked process */
-    pcb_t* proc = semWakeup(&devSems[EXT_IL_INDEX(deviceLineNo) * DEVPERINT + deviceNo]);
-
-    /*
-     * proc should never be NULL, but
-     * bad implementations (such as using devices without DOIO)
-     * make proc NULL
-     * could be NULL also if the process get terminated actually
-     */
-    if (proc != NULL) {
-        --softBlockCount;
-        proc->p_s.reg_v0 = status;
-    }
-
-    returnFromIntException();
+    /* wake up the blocked process (deferred) */
+    workQueue(work);
 }
 
-HIDDEN void terminalInterruptHandler()
+HIDDEN void terminalInterruptHandler(unsigned int line, unsigned int terminalNo)
 {
-    /* determine the terminal with a pending interrupt */
-    unsigned int terminalNo = lsb(*((memaddr*) CDEV_BITMAP_ADDR(TERMINT)));
     /* terminal register */
-    termreg_t* terminalReg = (termreg_t*) DEV_REG_ADDR(TERMINT, terminalNo);
+    termreg_t* terminalReg = (termreg_t*) DEV_REG_ADDR(line, terminalNo);
 
-    devregf_t status;
-    pcb_t* proc;
+    /*
+     * we need to determine the terminal sub-devices with a pending interrupt,
+     * both of them may have one: the transmitter (writing) is served first,
+     * then the receiver (reading)
+     */
+    terminalSubDeviceHandler(&terminalReg->transm_status, &terminalReg->transm_command, &termWork[0][terminalNo]);
+    terminalSubDeviceHandler(&terminalReg->recv_status, &terminalReg->recv_command, &termWork[1][terminalNo]);
+}
 
+/*
+ * Serve a terminal sub-device, if it has a pending interrupt
+ */
+HIDDEN void terminalSubDeviceHandler(devregf_t* statusReg, devregf_t* commandReg, work_t* work)
+{
     /*
-     * we need to determine the terminal sub-device with a pending interrupt...
-     * terminal transmitter (writing) has priority over terminal receiver (reading)
-     * to determine which sub-device has a pending interrupt
-     * we check that the status of each sub-device is not on READY
+     * to determine if the sub-device has a pending interrupt
+     * we check that its status is not on READY
      * but be careful...
      * when a sub-device terminal is handling a requested operation
      * the status field is on BUSY
@@ -148,31 +318,26 @@ HIDDEN void terminalInterruptHandler()
      * and the other one is handling a requested operation
      * that's why we also need to make sure that the status of the sub device is not BUSY too
      */
-    if (
-        (terminalReg->transm_status & TERM_STATUS_MASK) != BUSY &&
-        (terminalReg->transm_status & TERM_STATUS_MASK) != READY
-    ) {
-        /* save off the transmitter status field since after ACK it will be overwritten */
-        status = terminalReg->transm_status;
-        /* ACK the transmitted character */
-        terminalReg->transm_command = ACK;
-        /* wake up the blocked process */
-        proc = semWakeup(&termSems[0][terminalNo]);
-    } else if (
-        (terminalReg->recv_status & TERM_STATUS_MASK) != BUSY &&
-        (terminalReg->recv_status & TERM_STATUS_MASK) != READY
-    ) {
-        /* save off the receiver status field since after ACK it will be overwritten */
-        status = terminalReg->recv_status;
-        /* ACK the received character */
-        terminalReg->recv_command = ACK;
-        /* wake up the blocked process */
-        proc = semWakeup(&termSems[1][terminalNo]);
-    } else {
-        /* this should never happen */
-        ;
+    if ((*statusReg & TERM_STATUS_MASK) == BUSY || (*statusReg & TERM_STATUS_MASK) == READY) {
+        return;
     }
 
+    /* save off the status field since after ACK it will be overwritten */
+    work->w_status = *statusReg;
+    /* ACK the transmitted / received character */
+    *commandReg = ACK;
+    /* wake up the blocked process (deferred) */
+    workQueue(work);
+}
+
+/*
+ * Bottom half of a device (or terminal sub-device) interrupt:
+ * the I/O is complete, wake up the process waiting for it with the device status
+ */
+HIDDEN void ioCompletionWorkHandler(work_t* w)
+{
+    pcb_t* proc = semWakeup(w->w_sem);
+
     /*
      * proc should never be NULL, but
      * bad implementations (such as using devices without DOIO)
@@ -181,8 +346,6 @@ HIDDEN void terminalInterruptHandler()
      */
     if (proc != NULL) {
         --softBlockCount;
-        proc->p_s.reg_v0 = status;
+        proc->p_s.reg_v0 = w->w_status;
     }
-
-    returnFromIntException();
 }
@@ -0,0 +1,232 @@
+#include <umps/libumps.h>
+#include "pandos_types.h"
+#include "pandos_const.h"
+
+#include "phase2/scheduler.h"
+#include "phase2/variables.h"
+#include "phase1/pcb.h"
+
+/*
+ * Multi-level feedback queue scheduling policy (default)
+ * one ready queue for each level, the quantum doubles at each level
+ */
+#ifndef SCHED_FAIR
+
+/* ready queues, one for each level (0 is the top one) */
+HIDDEN list_head_t readyQueues[MLFQ_LEVELS];
+
+/* current aging epoch (see aging) and TOD of its start */
+HIDDEN unsigned int agingEpoch;
+HIDDEN cpu_t        agingTime;
+
+/*
+ * Put the process in the top level of its priority
+ */
+HIDDEN void resetLevel(pcb_t* p)
+{
+    p->p_level = MLFQ_TOP_LEVEL(p->p_basePrio);
+    p->p_agingEpoch = agingEpoch;
+}
+
+/*
+ * Level the process is queued in when ready
+ * a process not aged since the last aging epoch goes back to its top level,
+ * a process that inherited a higher priority is queued in the top level of that priority
+ */
+HIDDEN int levelOf(pcb_t* p)
+{
+    if (p->p_agingEpoch != agingEpoch) {
+        resetLevel(p);
+    }
+
+    if (p->p_prio > p->p_basePrio) {
+        return MLFQ_TOP_LEVEL(p->p_prio);
+    }
+
+    return p->p_level;
+}
+
+HIDDEN inline list_head_t* readyQueueOf(pcb_t* p)
+{
+    return &readyQueues[levelOf(p)];
+}
+
+/*
+ * Every MLFQ_AGING_PERIOD all the processes go back to their top level,
+ * so that the lower levels can't starve:
+ * the ready ones are requeued now (in order), the others when they get ready again
+ * (checked on dispatch: no timer is needed, there's nobody to age on an idle system)
+ */
+HIDDEN void aging()
+{
+    cpu_t now;
+    STCK(now);
+
+    if ((unsigned int) (now - agingTime) < MLFQ_AGING_PERIOD) {
+        return;
+    }
+
+    agingTime = now;
+    ++agingEpoch;
+
+    list_head_t aged;
+    mkEmptyProcQ(&aged);
+
+    /* the top level is made only of processes in their top level already */
+    for (int level = 1; level < MLFQ_LEVELS; ++level) {
+        pcb_t* p;
+        while ((p = removeProcQ(&readyQueues[level])) != NULL) {
+            insertProcQ(&aged, p);
+        }
+    }
+
+    pcb_t* p;
+    while ((p = removeProcQ(&aged)) != NULL) {
+        schedEnqueue(p);
+    }
+}
+
+void schedInit()
+{
+    for (size_t i = 0; i < MLFQ_LEVELS; ++i) {
+        mkEmptyProcQ(&readyQueues[i]);
+    }
+
+    agingEpoch = 0;
+    STCK(agingTime);
+}
+
+void schedEnqueue(pcb_t* p)
+{
+    insertProcQ(readyQueueOf(p), p);
+}
+
+void schedDequeue(pcb_t* p)
+{
+    if (schedIsQueued(p)) {
+        outProcQ(p->p_queue, p);
+    }
+}
+
+int schedIsQueued(const pcb_t* p)
+{
+    return p->p_queue >= &readyQueues[0] && p->p_queue < &readyQueues[MLFQ_LEVELS];
+}
+
+/*
+ * the woken processes are spliced directly in their ready queue
+ */
+list_head_t* schedWakeQueue(pcb_t* p)
+{
+    return readyQueueOf(p);
+}
+
+/*
+ * Dispatch from the highest non-empty level, with the quantum of that level
+ */
+pcb_t* schedPick(unsigned int* quantum)
+{
+    aging();
+
+    /*
+     * make sure to set forceLowQ
+     * just if there are processes available in the lower levels
+     */
+    int firstLevel = 0;
+    if (forceLowQ) {
+        for (int level = 1; level < MLFQ_LEVELS; ++level) {
+            if (!emptyProcQ(&readyQueues[level])) {
+                firstLevel = 1;
+                break;
+            }
+        }
+    }
+    forceLowQ = 0; /* valid just for one call */
+
+    for (int level = firstLevel; level < MLFQ_LEVELS; ++level) {
+        if (!emptyProcQ(&readyQueues[level])) {
+            *quantum = MLFQ_QUANTUM(level);
+            return removeProcQ(&readyQueues[level]);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * A process made ready takes the CPU from one of a lower level
+ */
+int schedPreempts(pcb_t* p, pcb_t* curr)
+{
+    return levelOf(p) < levelOf(curr);
+}
+
+/*
+ * Direct handoff: p is dispatched right away, ahead of the processes
+ * of its own level, if no higher level has ready processes
+ */
+int schedHandoff(pcb_t* p, unsigned int* quantum)
+{
+    if (!schedIsQueued(p)) {
+        return 0;
+    }
+
+    int level = p->p_queue - readyQueues;
+    for (int l = 0; l < level; ++l) {
+        if (!emptyProcQ(&readyQueues[l])) {
+            return 0;
+        }
+    }
+
+    outProcQ(p->p_queue, p);
+    *quantum = MLFQ_QUANTUM(level);
+
+    return 1;
+}
+
+void schedNew(pcb_t* p)
+{
+    resetLevel(p);
+}
+
+void schedCharge(pcb_t* p, cpu_t time)
+{
+    /* the levels depend on the quanta, not on the accumulated time */
+    (void) p;
+    (void) time;
+}
+
+/*
+ * The process burnt its whole quantum: it goes down one level
+ */
+void schedPreempted(pcb_t* p)
+{
+    if (p->p_level < MLFQ_LEVELS - 1) {
+        ++p->p_level;
+    }
+}
+
+/*
+ * The process blocked for an I/O: it goes up one level
+ * (never above the top level of its priority)
+ */
+void schedIoBlocked(pcb_t* p)
+{
+    if (p->p_level > MLFQ_TOP_LEVEL(p->p_basePrio)) {
+        --p->p_level;
+    }
+}
+
+/*
+ * if the process is in the top level
+ * make sure to try to force the lower levels on the context switch
+ * (otherwise the same process would probably be scheduled again)
+ */
+void schedYield(pcb_t* p)
+{
+    if (readyQueueOf(p) == &readyQueues[0]) {
+        forceLowQ = 1;
+    }
+}
+
+#endif
@@ -1,28 +1,160 @@
 #include <umps/libumps.h>
 #include "pandos_const.h"
+#include "utils.h"
 
 #include "phase2/scheduler.h"
+#include "phase2/edf.h"
+#include "phase2/groups.h"
+#include "phase2/work.h"
+#include "phase2/smp.h"
 #include "phase2/variables.h"
-#include "phase1/pcb.h"
 
-cpu_t schedulingTime;
+/* (per processor) dispatch time of the current process */
+cpu_t schedulingTimes[NCPU];
+
+/* (per processor) a ready process outranks the current one (see readyNotify) */
+HIDDEN int outranked[NCPU];
+/* (per processor) process woken by the current one, and its pid (see handoffHint) */
+HIDDEN pcb_t* handoffTarget[NCPU];
+HIDDEN pid_t  handoffPid[NCPU];
+
+/*
+ * Called when the process p has been made ready:
+ * if it outranks the current process, the current one is preempted
+ * on the next return from an interrupt (see interrupts.c)
+ * instead of running up to the end of its quantum
+ */
+void readyNotify(pcb_t* p)
+{
+    if (currentProcess != NULL && p != currentProcess && edfPreempts(p, currentProcess)) {
+        outranked[CPUID()] = 1;
+    }
+}
+
+/*
+ * Checks if a process made ready since the last dispatch outranks the current one
+ */
+int preemptPending()
+{
+    return outranked[CPUID()];
+}
+
+/*
+ * Record that the current process has just woken up p (e.g. with a V):
+ * if the current process blocks before being descheduled,
+ * p gets the CPU directly (see handoffScheduler)
+ */
+void handoffHint(pcb_t* p)
+{
+    handoffTarget[CPUID()] = p;
+    handoffPid[CPUID()] = p->p_pid;
+}
+
+/*
+ * Run the current process (with the given quantum, in microseconds)
+ */
+HIDDEN void dispatch(unsigned int quantum)
+{
+    /* the dispatched process is the best one available */
+    outranked[CPUID()] = 0;
+    handoffTarget[CPUID()] = NULL;
+
+    /* not beyond the quota of its group */
+    quantum = groupQuantum(currentProcess, quantum);
+
+    /*
+     * save scheduling time for each scheduled process
+     * needed for a correct accumulated processor time field management
+     * (taken before arming the PLT: at its interrupt the charged time
+     * is never below the quantum, e.g. a real-time budget runs out exactly)
+     */
+    STCK(schedulingTimes[CPUID()]);
+    setTIMER(quantum * (*((cpu_t*) TIMESCALEADDR)));
+
+    /* no stale translations (see tlbShootdownStart), fewer interrupts while busy */
+    tlbSync();
+    cpuBusy(1);
+
+    /*
+     * the state is loaded from a copy on the BIOS Data Page of this processor,
+     * taken under the kernel lock: once it's released, the PCB can be
+     * changed (or killed, see kill) from the other processors
+     */
+    state_t* processorState = (state_t*) PROCESSORSTATE(CPUID());
+    stateCopy(processorState, &currentProcess->p_s);
+    kernelUnlock();
+
+    /* load processor state with the state of the soon-to-be-executing process */
+    LDST(processorState);
+}
+
+/*
+ * Scheduler called when the current process blocks
+ * direct handoff: the process it has just woken up is taken out of the
+ * ready queue and dispatched right away, as long as it's still ready
+ * (and the same process) and no ready process outranks it;
+ * the full scheduler is called otherwise
+ * (e.g. a producer/consumer ping-pong switches back and forth directly)
+ */
+void handoffScheduler()
+{
+    pcb_t* p = handoffTarget[CPUID()];
+    unsigned int quantum;
+
+    if (p != NULL && p->p_pid == handoffPid[CPUID()] && edfHandoff(p, &quantum) && !groupPark(p)) {
+        currentProcess = p;
+        dispatch(quantum);
+    }
+
+    scheduler();
+}
+
+/*
+ * Wait for an interrupt, with no current process
+ * (the PLT, if given a poll period, is used just to look again at the ready queues)
+ */
+HIDDEN void idle(unsigned int poll)
+{
+    /* there's no current executing process since we are going to wait */
+    currentProcess = NULL;
+    /* enable all interrupts except PLT interrupt (just an idle poll with more processors) */
+    setTIMER(poll ? poll * (*((cpu_t*) TIMESCALEADDR)) : 0xFFFFFFFF);
+    cpuBusy(0);
+    kernelUnlock();
+    setSTATUS(getSTATUS() | IMON | IECON);
+    WAIT();
+}
 
 void scheduler()
 {
+    /* quantum of the process to dispatch (in microseconds) */
+    unsigned int quantum;
+
+    /* deferred work queued out of the interrupt handler, before dispatching or going idle */
+    workRun();
+
     /*
-     * make sure to set forceLowQ
-     * just if there are low priority processes available
+     * the interrupt processor (built with IRQ_CPU) never runs processes:
+     * it just services the interrupts routed to it
      */
-    forceLowQ = forceLowQ && !emptyProcQ(procQLow);
-
-    if (!emptyProcQ(procQHigh) && !forceLowQ) {
-        /* dispatch high priority processes first! */
-        currentProcess = removeProcQ(procQHigh);
-    } else if (!emptyProcQ(procQLow)) {
-        /* dispatch low priority processes */
-        currentProcess = removeProcQ(procQLow);
-        setTIMER(TIMESLICE * (*((cpu_t*) TIMESCALEADDR)));
-        forceLowQ = 0; /* valid just for one call */
+    if (CPUID() == IRQCPU) {
+        idle(0);
+    }
+
+    /*
+     * the real-time processes come first, then the ones of the scheduling policy
+     * (a process of a throttled group woken up with many others at once,
+     * see semWakeupAll, is parked in its group just now)
+     */
+    do {
+        currentProcess = edfPick(&quantum);
+        if (currentProcess == NULL) {
+            currentProcess = schedPick(&quantum);
+        }
+    } while (currentProcess != NULL && groupPark(currentProcess));
+
+    if (currentProcess != NULL) {
+        dispatch(quantum);
     } else {
         /* no processes to dispatch in the ready queues... */
         if (processCount == 0) {
@@ -31,14 +163,12 @@ void scheduler()
              * NB: this assumes that softBlockCount is correctly implemented
              */
             HALT();
-        } else if (softBlockCount > 0) {
-            /* wait for an I/O to complete (or pseudo-clock timer) */
-            /* there's no current executing process since we are going to wait */
-            currentProcess = NULL;
-            /* enable all interrupts except PLT interrupt */
-            setTIMER(0xFFFFFFFF); // try to avoid it
-            setSTATUS(getSTATUS() | IMON | IECON);
-            WAIT();
+        } else if (softBlockCount > 0 || groupsParked() > 0 || cpusRunning() > 0) {
+            /*
+             * wait for an I/O to complete (or pseudo-clock timer, or the refill of a group)
+             * or, with more processors, for a process made ready by the others
+             */
+            idle(NCPU > 1 ? IDLE_POLL : 0);
         } else if (softBlockCount == 0) {
             /* deadlock! */
             PANIC();
@@ -47,12 +177,4 @@ void scheduler()
             ;
         }
     }
-
-    /*
-     * save scheduling time for each scheduled process
-     * needed for a correct accumulated processor time field management
-     */
-    STCK(schedulingTime);
-    /* load processor state with the state of the soon-to-be-executing process */
-    LDST(&currentProcess->p_s);
 }
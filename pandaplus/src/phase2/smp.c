@@ -0,0 +1,161 @@
+#include <umps/libumps.h>
+#include <umps/arch.h>
+#include "pandos_types.h"
+#include "pandos_const.h"
+#include "utils.h"
+
+#include "phase2/smp.h"
+#include "phase2/scheduler.h"
+#include "phase2/variables.h"
+
+/*
+ * Symmetric multiprocessing (NCPU > 1)
+ * every processor runs the same kernel, serialized by a single kernel lock:
+ * it's taken on every exception and released when the processor goes back
+ * to a process (or to idle), so the kernel data structures (ready queues, ASL,
+ * PCB pool, timers, ...) need no finer locking;
+ * the ready queues are shared, so every processor that gets free takes the
+ * best ready process, wherever it was made ready
+ */
+
+/*
+ * Number of processors (other than this one) running a process
+ */
+int cpusRunning()
+{
+    int running = 0;
+
+    for (unsigned int cpu = 0; cpu < NCPU; ++cpu) {
+        if (cpu != CPUID() && currentProcs[cpu] != NULL) {
+            ++running;
+        }
+    }
+
+    return running;
+}
+
+#if NCPU > 1
+
+/* kernel lock, 0 = free / 1 = taken */
+HIDDEN volatile unsigned int kernelLockWord;
+
+/*
+ * TLB shootdown: the pager bumps tlbEpoch after invalidating a page table entry,
+ * every processor clears its TLB once it sees a new epoch (see tlbSync)
+ */
+HIDDEN volatile unsigned int tlbEpoch;
+HIDDEN volatile unsigned int cpuTlbEpoch[NCPU];
+
+/* start state of the secondary processors */
+HIDDEN state_t cpuStartState;
+
+void kernelLock()
+{
+    while (!CAS(&kernelLockWord, 0, 1)) {
+        ;
+    }
+}
+
+void kernelUnlock()
+{
+    kernelLockWord = 0;
+}
+
+/*
+ * Entry point of the secondary processors (on their own kernel stack)
+ */
+HIDDEN void cpuStart()
+{
+    kernelLock();
+    scheduler();
+}
+
+/*
+ * Route the interrupts and start the secondary processors
+ * (they wait for the kernel lock, held by the boot processor)
+ * the routing is dynamic: an interrupt goes to the processor with the lowest
+ * task priority, so the idle ones (see cpuBusy) take the device interrupts first;
+ * with IRQ_CPU it's static, all the interrupts go to the interrupt processor
+ * (device interrupt storms don't steal cycles, nor pollute the TLB,
+ * of the processors running processes)
+ */
+void smpInit()
+{
+#ifdef IRQ_CPU
+    const memaddr route = 1 << IRQCPU;
+#else
+    const memaddr route = (1 << IRT_ENTRY_POLICY_BIT) | ((1 << NCPU) - 1);
+#endif
+
+    *((memaddr*) IRT_ENTRY(IL_TIMER, 0)) = route;
+    for (unsigned int line = DEV_IL_START; line < N_INTERRUPT_LINES; ++line) {
+        for (unsigned int dev = 0; dev < N_DEV_PER_IL; ++dev) {
+            *((memaddr*) IRT_ENTRY(line, dev)) = route;
+        }
+    }
+
+    stateClear(&cpuStartState);
+    cpuStartState.status = TEBITON; /* PLT, INTERRUPTS MASKED, KERNEL MODE */
+    cpuStartState.pc_epc = cpuStartState.reg_t9 = (memaddr) cpuStart;
+
+    for (unsigned int cpu = 1; cpu < NCPU; ++cpu) {
+        cpuStartState.reg_sp = CPUSTACK(cpu);
+        INITCPU(cpu, &cpuStartState);
+    }
+}
+
+/*
+ * Set the task priority of this processor, used by the interrupt routing
+ * (0 = idle, 1 = running a process)
+ */
+void cpuBusy(int busy)
+{
+    *((memaddr*) CPUCTL_TPR) = busy;
+}
+
+/*
+ * Clear the TLB of this processor if a page table entry has been invalidated
+ * since the last time (called with the kernel lock, before going back to a process)
+ */
+void tlbSync()
+{
+    unsigned int epoch = tlbEpoch;
+
+    if (cpuTlbEpoch[CPUID()] != epoch) {
+        TLBCLR();
+        cpuTlbEpoch[CPUID()] = epoch;
+    }
+}
+
+/*
+ * Called by the pager after invalidating a page table entry (and clearing its TLB),
+ * while it owns the swap pool (so the epochs are handed out one at a time)
+ * returns the epoch every processor must reach (see tlbShootdownDone)
+ */
+unsigned int tlbShootdownStart()
+{
+    unsigned int epoch = ++tlbEpoch;
+    cpuTlbEpoch[CPUID()] = epoch;
+
+    return epoch;
+}
+
+/*
+ * Checks if no other processor can still use the translations stale at the given epoch,
+ * i.e. every processor running a process has gone through the kernel and
+ * cleared its TLB (the idle ones clear it before dispatching)
+ * it takes a quantum at most: a running process gets back to the kernel on its PLT
+ */
+int tlbShootdownDone(unsigned int epoch)
+{
+    for (unsigned int cpu = 0; cpu < NCPU; ++cpu) {
+        /* a later shootdown (of another pager) covers this one too */
+        if (currentProcs[cpu] != NULL && (int) (epoch - cpuTlbEpoch[cpu]) > 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+#endif
@@ -7,8 +7,13 @@
 
 #include "phase2/syscalls.h"
 #include "phase2/scheduler.h"
+#include "phase2/edf.h"
+#include "phase2/groups.h"
+#include "phase2/timers.h"
 #include "phase2/exceptions.h"
+#include "phase2/interrupts.h"
 #include "phase2/helpers.h"
+#include "phase2/smp.h"
 #include "phase2/variables.h"
 #include "phase1/asl.h"
 #include "phase1/pcb.h"
@@ -16,19 +21,30 @@
 /* --- prototypes --- */
 
 HIDDEN void sysContextSwitch();
+HIDDEN void sysBlockSwitch();
 HIDDEN void returnFromSysException();
 HIDDEN void setSysReturnValue(unsigned int v);
 
 HIDDEN void createProcess(state_t* pstate, int prio, support_t* psupport);
 HIDDEN void terminateProcess(pid_t pid);
-HIDDEN void passeren(sem_t* semAddr);
-HIDDEN void verhogen(sem_t* semAddr);
+HIDDEN int  semP(sem_t* semAddr, int flags);
+HIDDEN void semV(sem_t* semAddr, int flags);
+HIDDEN void passeren(sem_t* semAddr, int flags);
+HIDDEN void verhogen(sem_t* semAddr, int flags);
 HIDDEN void doIoDevice(devregf_t* commandAddr, devregf_t commandValue);
 HIDDEN void getCpuTime();
 HIDDEN void waitForClock();
 HIDDEN void getSupportData();
 HIDDEN void getProcessId(int parent);
 HIDDEN void yield();
+HIDDEN void semBroadcast(sem_t* semAddr);
+HIDDEN void setRealTime(unsigned int period, unsigned int budget);
+HIDDEN void semSignalWait(sem_t* signalAddr, sem_t* waitAddr);
+HIDDEN void setGroup(unsigned int group);
+HIDDEN void setQuota(unsigned int group, unsigned int quota, unsigned int period);
+HIDDEN void getGroupUsage(unsigned int group);
+HIDDEN void sleepFor(int usecs);
+HIDDEN void sleepTimerExpired(ktimer_t* t);
 
 extern cpu_t startingTime;
 
@@ -77,10 +93,10 @@ void syscallExceptionHandler(state_t* pstate)
             terminateProcess(arg1);
             break;
         case PASSEREN: /* NSYS3 (sem_wait) */
-            passeren((sem_t*) arg1);
+            passeren((sem_t*) arg1, arg2);
             break;
         case VERHOGEN: /* NSYS4 (sem_post) */
-            verhogen((sem_t*) arg1);
+            verhogen((sem_t*) arg1, arg2);
             break;
         case DOIO: /* NSYS5 */
             doIoDevice((devregf_t*) arg1, (devregf_t) arg2);
@@ -100,6 +116,27 @@ void syscallExceptionHandler(state_t* pstate)
         case YIELD: /* NSYS10 */
             yield();
             break;
+        case SEMBROADCAST: /* NSYS11 */
+            semBroadcast((sem_t*) arg1);
+            break;
+        case SETREALTIME: /* NSYS12 */
+            setRealTime(arg1, arg2);
+            break;
+        case SEMSIGNALWAIT: /* NSYS13 */
+            semSignalWait((sem_t*) arg1, (sem_t*) arg2);
+            break;
+        case SETGROUP: /* NSYS14 */
+            setGroup(arg1);
+            break;
+        case SETQUOTA: /* NSYS15 */
+            setQuota(arg1, arg2, arg3);
+            break;
+        case GETGROUPUSAGE: /* NSYS16 */
+            getGroupUsage(arg1);
+            break;
+        case SLEEP: /* NSYS17 */
+            sleepFor(arg1);
+            break;
         default:
             generateException(EXC_RI); /* non-existent kernel syscall */
             break;
@@ -108,13 +145,13 @@ void syscallExceptionHandler(state_t* pstate)
 
 /* --- support functions --- */
 
-HIDDEN void sysContextSwitch()
+HIDDEN void sysSaveState()
 {
     /*
      * update the processor state of the current executing process
      * before descheduling it
      */
-    memcpy(&currentProcess->p_s, (state_t*) PROCESSORSTATE0, sizeof(state_t));
+    stateCopy(&currentProcess->p_s, (state_t*) PROCESSORSTATE(CPUID()));
     /*
      * make sure that when the process is scheduled again
      * it doesnt start from the syscall already handled
@@ -123,20 +160,35 @@ HIDDEN void sysContextSwitch()
     currentProcess->p_s.pc_epc += WORDLEN;
     /* update accumulated processor time by the current process before scheduling */
     updateCpuTime();
+}
 
+HIDDEN void sysContextSwitch()
+{
+    sysSaveState();
     scheduler();
 }
 
+/*
+ * Context switch of a process that blocked on a semaphore:
+ * the process it has just woken up (if any) can get the CPU directly
+ */
+HIDDEN void sysBlockSwitch()
+{
+    sysSaveState();
+    handoffScheduler();
+}
+
 HIDDEN void returnFromSysException()
 {
     /* avoid infinite syscall loops */
-    ((state_t*) PROCESSORSTATE0)->pc_epc += WORDLEN;
-    LDST((state_t*) PROCESSORSTATE0);
+    ((state_t*) PROCESSORSTATE(CPUID()))->pc_epc += WORDLEN;
+    kernelUnlock();
+    LDST((state_t*) PROCESSORSTATE(CPUID()));
 }
 
 HIDDEN void setSysReturnValue(unsigned int v)
 {
-    ((state_t*) PROCESSORSTATE0)->reg_v0 = v;
+    ((state_t*) PROCESSORSTATE(CPUID()))->reg_v0 = v;
 }
 
 /* --- syscalls --- */
@@ -147,38 +199,45 @@ HIDDEN void setSysReturnValue(unsigned int v)
 HIDDEN inline pid_t allocPid() {
     static pid_t lastpid = 1;
 
-    /* get a pid in the allowed range */
-    pid_t pid = PID_MIN + (++lastpid - PID_MIN) % (PID_MAX - PID_MIN + 1);
-
-    /* make sure the pid is unique */
-    size_t i = 1;
-    while (i <= PID_MAX - PID_MIN && findPcb(pid) != NULL) {
-        pid = PID_MIN + (++lastpid - PID_MIN) % (PID_MAX - PID_MIN + 1);
-        ++i;
-    }
+    /*
+     * make sure the pid is unique
+     * each findPcb is O(1) and the first candidate is almost always free,
+     * since the live processes are way less than the allowed range
+     */
+    for (size_t i = 0; i <= PID_MAX - PID_MIN; ++i) {
+        /* get the next pid in the allowed range */
+        lastpid = PID_MIN + (lastpid + 1 - PID_MIN) % (PID_MAX - PID_MIN + 1);
 
-    if (i == PID_MAX - PID_MIN && findPcb(pid) != NULL) {
-        return -1; /* can't find a valid pid in the allowed range */
+        if (findPcb(lastpid) == NULL) {
+            return lastpid;
+        }
     }
 
-    return pid;
+    return -1; /* can't find a valid pid in the allowed range */
 }
 
 HIDDEN void createProcess(state_t* pstate, int prio, support_t* psupport)
 {
     pcb_t* proc = allocPcb();
-    pid_t pid = allocPid();
+    pid_t pid = proc != NULL ? allocPid() : -1;
+
+    if (pid == -1) {
+        if (proc != NULL) {
+            freePcb(proc);
+        }
 
-    if (proc == NULL || pid == -1) {
         setSysReturnValue(-1);
         returnFromSysException();
     }
 
     /* new process setup */
     proc->p_pid = pid;
-    proc->p_prio = prio;
+    proc->p_prio = proc->p_basePrio = prio;
+    schedNew(proc);
     proc->p_supportStruct = psupport;
-    memcpy(&proc->p_s, pstate, sizeof(state_t));
+    proc->p_group = currentProcess->p_group;
+    stateCopy(&proc->p_s, pstate);
+    insertPid(proc);
 
     /* the new process is part of the progeny of the caller */
     insertChild(currentProcess, proc);
@@ -206,37 +265,110 @@ HIDDEN void terminateProcess(pid_t pid)
 }
 
 /*
- * NSYS3 (sem_wait)
+ * P on the semaphore, without leaving the kernel
+ * returns 1 if the caller has been blocked on the semaphore, 0 otherwise
  */
-HIDDEN void passeren(sem_t* semAddr)
+HIDDEN int semP(sem_t* semAddr, int flags)
 {
     if (*semAddr == 0) {
         semSuspend(semAddr);
-        sysContextSwitch();
+
+        if (flags & SEM_MUTEX) {
+            pcb_t* owner = getSemOwner(semAddr);
+
+            if (owner != NULL) {
+                updateInheritedPrio(owner);
+            }
+        }
+
+        return 1;
+    }
+
+    /* decrement only if we could not wake up any process */
+    if (semWakeup(semAddr) == NULL) {
+        --(*semAddr); /* (0) */
+    }
+
+    /* the caller got the semaphore either way, so it's the new owner */
+    if (flags & SEM_MUTEX) {
+        pcb_t* owner = getSemOwner(semAddr);
+
+        /* PANIC if we run out of semaphores */
+        if (setSemOwner(semAddr, currentProcess) == 1) {
+            PANIC();
+        }
+
+        if (owner != NULL && owner != currentProcess) {
+            updateInheritedPrio(owner);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * V on the semaphore, which must not be on 1 (the caller would block)
+ * the woken process (if any) is the target of a direct handoff
+ * if the caller blocks right after (see handoffScheduler)
+ */
+HIDDEN void semV(sem_t* semAddr, int flags)
+{
+    pcb_t* proc = semWakeup(semAddr);
+
+    /* increment only if we could not wake up any process */
+    if (proc == NULL) {
+        ++(*semAddr); /* (1) */
     } else {
-        /* decrement only if we could not wake up any process */
-        if (semWakeup(semAddr) == NULL) {
-            --(*semAddr); /* (0) */
+        handoffHint(proc);
+    }
+
+    if (flags & SEM_MUTEX) {
+        pcb_t* owner = getSemOwner(semAddr);
+
+        /*
+         * if proc was the last waiter and there was no owner, its semd
+         * has just been freed: a new one is needed to record proc
+         * PANIC if we run out of semaphores
+         */
+        if (setSemOwner(semAddr, proc) == 1) {
+            PANIC();
         }
 
+        if (owner != NULL) {
+            updateInheritedPrio(owner);
+        }
+        if (proc != NULL) {
+            updateInheritedPrio(proc);
+        }
+    }
+}
+
+/*
+ * NSYS3 (sem_wait)
+ * with SEM_MUTEX the caller becomes the owner of the semaphore once it gets it,
+ * and while it's waiting for it the current owner inherits its priority
+ */
+HIDDEN void passeren(sem_t* semAddr, int flags)
+{
+    if (semP(semAddr, flags)) {
+        sysBlockSwitch();
+    } else {
         returnFromSysException();
     }
 }
 
 /* 
  * NSYS4 (sem_post / signal)
+ * with SEM_MUTEX the ownership passes to the woken process (if any),
+ * and the caller gives up the priority inherited from the semaphore
  */
-HIDDEN void verhogen(sem_t* semAddr)
+HIDDEN void verhogen(sem_t* semAddr, int flags)
 {
     if (*semAddr == 1) {
         semSuspend(semAddr);
         sysContextSwitch();
     } else {
-        /* increment only if we could not wake up any process */
-        if (semWakeup(semAddr) == NULL) {
-            ++(*semAddr); /* (1) */
-        }
-
+        semV(semAddr, flags);
         returnFromSysException();
     }
 }
@@ -275,11 +407,14 @@ HIDDEN void doIoDevice(devregf_t* commandAddr, devregf_t commandValue)
     /* begin I/O operation */
     *commandAddr = commandValue;
 
+    /* I/O bound processes may get a boost */
+    schedIoBlocked(currentProcess);
+
     sem_t* semAddr = getDeviceSemAddr((memaddr) commandAddr);
 
     ++softBlockCount;
     /* should always block since dev semaphores are used for sync */
-    passeren(semAddr);
+    passeren(semAddr, 0);
 }
 
 /*
@@ -298,9 +433,13 @@ HIDDEN void getCpuTime()
  */
 HIDDEN void waitForClock()
 {
+    /* a real-time process waiting for the next period has completed its job */
+    edfJobDone(currentProcess);
+
+    pseudoClockArm();
     ++softBlockCount;
     /* should always block since dev semaphores are used for sync */
-    passeren(&pseudoClockSem);
+    passeren(&pseudoClockSem, 0);
 }
 
 /*
@@ -335,16 +474,144 @@ HIDDEN void getProcessId(int parent)
  */
 HIDDEN void yield()
 {
-    /*
-     * if we are handling a high priority proces
-     * and the queue of high priority processes is empty
-     * make sure to try to force the queue of low priority processes
-     * on the context switch
-     */
-    if (currentProcess->p_prio == PROCESS_PRIO_HIGH && headProcQ(procQHigh)) {
-        forceLowQ = 1;
-    }
+    /* let the other processes run first (see the scheduling policy) */
+    schedYield(currentProcess);
 
     insertPrioProcQ(currentProcess);
     sysContextSwitch();
 }
+
+/*
+ * NSYS11
+ * wake up every process blocked in a P on the given semaphore
+ * (event broadcast), the value of the semaphore is left unchanged
+ * returns the number of woken processes, -1 on a device semaphore
+ * (its waiters are woken by the interrupt, with the device status in v0;
+ * the pseudo-clock fan-out is done by the kernel, see itInterruptHandler)
+ */
+HIDDEN void semBroadcast(sem_t* semAddr)
+{
+    if (isDeviceSemaphore(semAddr)) {
+        setSysReturnValue(-1);
+        returnFromSysException();
+    }
+
+    unsigned int n = 0;
+
+    /* with the value on 1 the blocked processes are waiting in a V instead */
+    if (*semAddr == 0) {
+        n = semWakeupAll(semAddr);
+    }
+
+    setSysReturnValue(n);
+    returnFromSysException();
+}
+
+/*
+ * NSYS12
+ * make the current process a real-time process (EDF class)
+ * with the given period and cpu budget per period (us),
+ * or a normal process again with a zero period
+ * returns 0 on success, -1 if the request fails the admission control
+ */
+HIDDEN void setRealTime(unsigned int period, unsigned int budget)
+{
+    setSysReturnValue(edfAdmit(currentProcess, period, budget));
+    returnFromSysException();
+}
+
+/*
+ * NSYS13
+ * V on signalAddr and P on waitAddr in a single syscall
+ * (e.g. the request/reply of a synchronous IPC): if the caller blocks
+ * in the P, the process woken by the V gets the CPU directly
+ * if the V would block (signalAddr on 1) the call behaves as a VERHOGEN,
+ * the P is not done and -1 is returned; 0 otherwise
+ */
+HIDDEN void semSignalWait(sem_t* signalAddr, sem_t* waitAddr)
+{
+    if (*signalAddr == 1) {
+        setSysReturnValue(-1);
+        semSuspend(signalAddr);
+        sysContextSwitch();
+    }
+
+    semV(signalAddr, 0);
+    setSysReturnValue(0);
+
+    if (semP(waitAddr, 0)) {
+        sysBlockSwitch();
+    } else {
+        returnFromSysException();
+    }
+}
+
+/*
+ * NSYS14
+ * move the current process to the given group (the processes it creates
+ * from now on are in it too); its cpu time is charged to the group
+ * returns 0 on success, -1 if the group doesn't exist
+ */
+HIDDEN void setGroup(unsigned int group)
+{
+    setSysReturnValue(groupJoin(currentProcess, group));
+    returnFromSysException();
+}
+
+/*
+ * NSYS15
+ * limit the processes of the group to quota us of cpu time every period us
+ * (a zero quota removes the limit)
+ * returns 0 on success, -1 if the request is not valid (e.g. group 0)
+ */
+HIDDEN void setQuota(unsigned int group, unsigned int quota, unsigned int period)
+{
+    setSysReturnValue(groupSetQuota(group, quota, period));
+    returnFromSysException();
+}
+
+/*
+ * NSYS16
+ * returns the cpu time (us) used by the processes of the group so far,
+ * -1 if the group doesn't exist
+ */
+HIDDEN void getGroupUsage(unsigned int group)
+{
+    setSysReturnValue(groupUsage(group));
+    returnFromSysException();
+}
+
+/*
+ * NSYS17
+ * block the caller for (at least) usecs microseconds without using the CPU,
+ * on its own one-shot kernel timer (no wait at all for usecs <= 0)
+ * the wait is soft-blocked like a CLOCKWAIT, but it ends on the exact expiry
+ * instead of the next pseudo-clock tick
+ */
+HIDDEN void sleepFor(int usecs)
+{
+    if (usecs <= 0) {
+        returnFromSysException();
+    }
+
+    cpu_t now;
+    STCK(now);
+
+    /* an int delay keeps the expiry comparable on the 32 bit TOD (see timers.c) */
+    currentProcess->p_sleepTimer.t_handler = sleepTimerExpired;
+    timerArm(&currentProcess->p_sleepTimer, now + usecs);
+    ++softBlockCount;
+
+    sysBlockSwitch();
+}
+
+/*
+ * The sleep of a process is over (a kernel timer)
+ */
+HIDDEN void sleepTimerExpired(ktimer_t* t)
+{
+    pcb_t* p = container_of(t, pcb_t, p_sleepTimer);
+
+    --softBlockCount;
+    insertPrioProcQ(p);
+}
@@ -0,0 +1,142 @@
+#include <umps/libumps.h>
+#include "pandos_types.h"
+#include "pandos_const.h"
+
+#include "phase2/timers.h"
+
+/*
+ * Kernel timer queue (tickless)
+ * the armed timers are kept ordered by expiry and the interval timer
+ * is programmed just for the earliest one, so there are no periodic
+ * interrupts: with no armed timers the interval timer never fires
+ */
+
+/* armed timers, ordered by expiry */
+HIDDEN list_head_t timerQueue;
+
+/*
+ * Time comparison, robust to the wraparound of the TOD clock
+ */
+HIDDEN inline int timeBefore(unsigned int a, unsigned int b)
+{
+    return (int) (a - b) < 0;
+}
+
+/*
+ * Load the interval timer as far as possible: ~71 minutes,
+ * reprogrammed before then anyway
+ */
+HIDDEN inline void idleTimer()
+{
+    *((cpu_t*) INTERVALTMR) = 0xFFFFFFFF;
+}
+
+/*
+ * Program the interval timer for the earliest armed timer
+ * (loading the interval timer also ACKs its interrupt)
+ */
+HIDDEN void programTimer()
+{
+    if (list_empty(&timerQueue)) {
+        idleTimer();
+        return;
+    }
+
+    ktimer_t* first = container_of(timerQueue.next, ktimer_t, t_link);
+
+    cpu_t now;
+    STCK(now);
+
+    /* an expired timer must fire right away */
+    int delta = first->t_expiry - now;
+    LDIT(delta > 0 ? delta : 1);
+}
+
+void timersInit()
+{
+    INIT_LIST_HEAD(&timerQueue);
+    programTimer();
+}
+
+/*
+ * Arm the timer for the given expiry time (TOD, in microseconds)
+ * an armed timer is moved to its new expiry
+ * (a timer with its links set to NULL is not armed)
+ */
+void timerArm(ktimer_t* t, unsigned int expiry)
+{
+    /* the interval timer needs to be changed only if the earliest expiry changes */
+    int wasFirst = 0;
+    if (timerArmed(t)) {
+        wasFirst = timerQueue.next == &t->t_link;
+        list_del(&t->t_link);
+    }
+
+    t->t_expiry = expiry;
+
+    /* FIFO between timers with the same expiry (O(1) for the latest expiry) */
+    list_head_t* pos;
+    list_for_each_prev(pos, &timerQueue) {
+        if (!timeBefore(expiry, container_of(pos, ktimer_t, t_link)->t_expiry)) {
+            break;
+        }
+    }
+    list_add(&t->t_link, pos);
+
+    if (wasFirst || timerQueue.next == &t->t_link) {
+        programTimer();
+    }
+}
+
+void timerCancel(ktimer_t* t)
+{
+    if (!timerArmed(t)) {
+        return;
+    }
+
+    int first = timerQueue.next == &t->t_link;
+    list_del(&t->t_link);
+    t->t_link.next = t->t_link.prev = NULL;
+
+    if (first) {
+        programTimer();
+    }
+}
+
+int timerArmed(const ktimer_t* t)
+{
+    return t->t_link.next != NULL;
+}
+
+/*
+ * Interval timer interrupt, top half: ACK it by reloading the interval timer,
+ * which stays idle until timersExpire programs the next expiry
+ * (the earliest timer has expired, so it can't be programmed for it)
+ */
+void timersAck()
+{
+    idleTimer();
+}
+
+/*
+ * Interval timer interrupt, bottom half: run the handlers of the expired timers
+ * (they may arm timers again) and program the interval timer for the next one
+ */
+void timersExpire()
+{
+    cpu_t now;
+    STCK(now);
+
+    while (!list_empty(&timerQueue)) {
+        ktimer_t* t = container_of(timerQueue.next, ktimer_t, t_link);
+        if (timeBefore(now, t->t_expiry)) {
+            break;
+        }
+
+        list_del(&t->t_link);
+        t->t_link.next = t->t_link.prev = NULL;
+        t->t_handler(t);
+    }
+
+    programTimer();
+}
@@ -0,0 +1,67 @@
+#include <umps/libumps.h>
+#include "pandos_types.h"
+#include "pandos_const.h"
+
+#include "phase2/work.h"
+#include "phase2/variables.h"
+
+/*
+ * Deferred work (top half / bottom half)
+ * the interrupt handlers (top halves) just save the device status, ACK it
+ * and queue a work item; the items (bottom halves: semaphore wakeups,
+ * ready queue insertions, softBlockCount, timer handlers, ...) are run
+ * in FIFO order once all the pending interrupts have been ACKed,
+ * before going back to a process or to idle (see workRun)
+ * the kernel is not reentrant, so the bottom halves still run with
+ * interrupts masked, but the time from an interrupt to the ACK of its
+ * device doesn't grow with the work done on its completion
+ */
+
+/* queued work items, FIFO */
+HIDDEN list_head_t workList;
+/* number of queued work items */
+HIDDEN unsigned int workDepth;
+
+void workInit()
+{
+    INIT_LIST_HEAD(&workList);
+    workDepth = 0;
+    workItems = workMaxDepth = 0;
+}
+
+/*
+ * Queue a work item, if it's not queued already
+ * (an item with its links set to NULL is not queued)
+ */
+void workQueue(work_t* w)
+{
+    if (workQueued(w)) {
+        return;
+    }
+
+    list_add_tail(&w->w_link, &workList);
+    if (++workDepth > workMaxDepth) {
+        workMaxDepth = workDepth;
+    }
+}
+
+int workQueued(const work_t* w)
+{
+    return w->w_link.next != NULL;
+}
+
+/*
+ * Run the queued work items (they may queue other items)
+ */
+void workRun()
+{
+    while (!list_empty(&workList)) {
+        work_t* w = container_of(workList.next, work_t, w_link);
+        list_del(&w->w_link);
+        w->w_link.next = w->w_link.prev = NULL;
+        --workDepth;
+        ++workItems;
+
+        w->w_handler(w);
+    }
+}
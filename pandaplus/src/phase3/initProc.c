@@ -2,6 +2,7 @@
 #include <umps3/umps/cp0.h>
 #include "pandos_types.h"
 #include "pandos_const.h"
+#include "utils.h"
 
 #include "phase3/vmSupport.h"
 #include "phase3/sysSupport.h"
@@ -20,6 +21,8 @@ void test() {
     /* U-proc processor state */
     /* note: it's not static because is gonna be copied by CREATEPROCESS */
     state_t pstate;
+    /* the registers not set below start from 0, not from the garbage on the stack */
+    stateClear(&pstate);
 
     unsigned int asid = 1;
     while (asid < UPROCMAX + 1) {
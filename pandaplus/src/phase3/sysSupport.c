@@ -19,6 +19,7 @@ HIDDEN void terminate(support_t* psupport);
 HIDDEN void writeToPrinter(support_t* psupport, char* strVirtAddr, int len);
 HIDDEN void writeToTerminal(support_t* psupport, char* strVirtAddr, int len);
 HIDDEN void readFromTerminal(support_t* psupport, char* strVirtAddr);
+HIDDEN void delay(support_t* psupport, int usecs);
 
 /* --- variables --- */
 
@@ -47,13 +48,11 @@ void initSysStructs()
  * Support General Exception Handler
  * all non-TLB related exceptions triggered by a process
  * with a correctly initialized support structure
- * starts from here
+ * starts from here, with the current process support struct
+ * (passed up by the kernel, no GETSUPPORTPTR needed)
  */
-void generalExceptionHandler()
+void generalExceptionHandler(support_t* psupport)
 {
-    /* get current process support struct */
-	support_t* psupport = (support_t*) SYSCALL(GETSUPPORTPTR, 0, 0, 0);
-
     /* retrieve the cause of the exception */
 	unsigned int excCode = CAUSE_GET_EXCCODE(psupport->sup_exceptState[GENERALEXCEPT].cause);
 
@@ -112,6 +111,9 @@ HIDDEN void syscallExceptionHandler(support_t* psupport)
         case READTERMINAL: /* SYS5 */
             readFromTerminal(psupport, (char*) arg1);
             break;
+        case DELAY: /* SYS6 */
+            delay(psupport, (int) arg1);
+            break;
         default:
             /* non-existent user syscall */
             break;
@@ -164,7 +166,7 @@ HIDDEN void writeToPrinter(support_t* psupport, char* strVirtAddr, int len)
     int i = 0;
     unsigned int status;
 
-    SYSCALL(PASSEREN, (int) &printerSems[printerNo], 0, 0);
+    SYSCALL(PASSEREN, (int) &printerSems[printerNo], SEM_MUTEX, 0);
 
     for (; i < len; ++i) {
         setSTATUS(getSTATUS() & (~IECON)); /* atomic on */
@@ -181,7 +183,7 @@ HIDDEN void writeToPrinter(support_t* psupport, char* strVirtAddr, int len)
         }
     }
 
-    SYSCALL(VERHOGEN, (int) &printerSems[printerNo], 0, 0);
+    SYSCALL(VERHOGEN, (int) &printerSems[printerNo], SEM_MUTEX, 0);
 
     /* return the number of characters transmitted */
     psupport->sup_exceptState[GENERALEXCEPT].reg_v0 = i;
@@ -204,7 +206,7 @@ HIDDEN void writeToTerminal(support_t* psupport, char* strVirtAddr, int len)
     int i = 0;
     unsigned int status;
 
-    SYSCALL(PASSEREN, (int) &termSems[0][terminalNo], 0, 0);
+    SYSCALL(PASSEREN, (int) &termSems[0][terminalNo], SEM_MUTEX, 0);
 
     for (; i < len; ++i) {
         setSTATUS(getSTATUS() & (~IECON)); /* atomic on */
@@ -220,7 +222,7 @@ HIDDEN void writeToTerminal(support_t* psupport, char* strVirtAddr, int len)
         }
     }
 
-    SYSCALL(VERHOGEN, (int) &termSems[0][terminalNo], 0, 0);
+    SYSCALL(VERHOGEN, (int) &termSems[0][terminalNo], SEM_MUTEX, 0);
 
     /* return the number of characters transmitted */
     psupport->sup_exceptState[GENERALEXCEPT].reg_v0 = i;
@@ -244,7 +246,7 @@ HIDDEN void readFromTerminal(support_t* psupport, char* strVirtAddr)
     char recvVal = ' '; /* null */
     unsigned int status;
 
-    SYSCALL(PASSEREN, (int) &termSems[1][terminalNo], 0, 0);
+    SYSCALL(PASSEREN, (int) &termSems[1][terminalNo], SEM_MUTEX, 0);
 
     while (recvVal != '\n') {
         setSTATUS(getSTATUS() & (~IECON)); /* atomic on */
@@ -265,10 +267,28 @@ HIDDEN void readFromTerminal(support_t* psupport, char* strVirtAddr)
         ++i;
     }
 
-    SYSCALL(VERHOGEN, (int) &termSems[1][terminalNo], 0, 0);
+    SYSCALL(VERHOGEN, (int) &termSems[1][terminalNo], SEM_MUTEX, 0);
 
     *strVirtAddr = '\0';
 
     psupport->sup_exceptState[GENERALEXCEPT].reg_v0 = i;
     returnFromSysException(psupport);
-}
\ No newline at end of file
+}
+
+/*
+ * SYS6
+ * sleep for (at least) usecs microseconds, without using the CPU:
+ * the kernel arms a one-shot timer for the U-proc (SLEEP), so the sleepers
+ * are kept ordered by wake time in the kernel timer queue and each one
+ * is woken on its own expiry, with no daemon polling the pseudo-clock
+ */
+HIDDEN void delay(support_t* psupport, int usecs)
+{
+    if (usecs < 0) {
+        terminate(psupport);
+    }
+
+    SYSCALL(SLEEP, usecs, 0, 0);
+
+    returnFromSysException(psupport);
+}
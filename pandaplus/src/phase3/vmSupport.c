@@ -7,18 +7,21 @@
 #include "phase3/vmSupport.h"
 #include "phase3/sysSupport.h"
 #include "phase2/variables.h"
+#include "phase2/smp.h"
 
 /* --- prototypes --- */
 
-HIDDEN void flashInit(unsigned int flashNo, devregf_t command, devregf_t data0);
-HIDDEN void flashRead(unsigned int flashNo, memaddr srcAddr, unsigned int blockNumber);
-HIDDEN void flashWrite(unsigned int flashNo, memaddr destAddr, unsigned int blockNumber);
+HIDDEN void flashInit(support_t* psupport, unsigned int flashNo, devregf_t command, devregf_t data0);
+HIDDEN void flashRead(support_t* psupport, unsigned int flashNo, memaddr srcAddr, unsigned int blockNumber);
+HIDDEN void flashWrite(support_t* psupport, unsigned int flashNo, memaddr destAddr, unsigned int blockNumber);
 
 HIDDEN void pageFaultHandler(support_t* psupport);
 
 /* --- variables --- */
 
 HIDDEN swap_t swapPoolTable[POOLSIZE];
+/* frames whose page is being written out, by a pager waiting for a TLB shootdown */
+HIDDEN int frameEvicting[POOLSIZE];
 HIDDEN sem_t swapPoolSem;
 HIDDEN sem_t flashSems[DEVPERINT];
 
@@ -34,6 +37,7 @@ void initVmStructs()
         /* frames at the start are unoccupied (obv) */
         swapPoolTable[i].sw_asid = -1;
         swapPoolTable[i].sw_pte = NULL;
+        frameEvicting[i] = 0;
 	}
 }
 
@@ -43,20 +47,22 @@ void initVmStructs()
  * TLB-Refill Handler
  * Note: it is part of the kernel phase2 code (it's a kernel function)
  *       so this function runs in single threaded mode with interrupts masked
+ *       (it just reads the page table of the current process of this processor,
+ *       no kernel lock needed)
  */
 void uTLB_RefillHandler()
 {
 #ifdef DEBUG
     static unsigned int bpTLBRefillVPN;
-    bpTLBRefillVPN = ENTRYHI_GET_VPN2(((state_t*) PROCESSORSTATE0)->entry_hi);
+    bpTLBRefillVPN = ENTRYHI_GET_VPN2(((state_t*) PROCESSORSTATE(CPUID()))->entry_hi);
     (void) bpTLBRefillVPN;
 #endif
 
     /*
      * get processor state at the time of the exception
-     * (stored at the start of the BIOS Data Page)
+     * (stored in the BIOS Data Page of this processor)
      */
-    state_t* processorState = (state_t*) PROCESSORSTATE0;
+    state_t* processorState = (state_t*) PROCESSORSTATE(CPUID());
 
 	/*
      * get virtual page number
@@ -80,13 +86,11 @@ void uTLB_RefillHandler()
  * TLB Exception Handler (also called the Pager)
  * all TLB exceptions (except TLB-Refill) triggered by a process
  * with a correctly initialized support struct
- * starts from here
+ * starts from here, with the current process support struct
+ * (passed up by the kernel, no GETSUPPORTPTR needed)
  */
-void tlbExceptionHandler()
+void tlbExceptionHandler(support_t* psupport)
 {
-    /* get current process support struct */
-	support_t* psupport = (support_t*) SYSCALL(GETSUPPORTPTR, 0, 0, 0);
-
 #ifdef DEBUG
     static unsigned int bpTLBExcCode;
     bpTLBExcCode = CAUSE_GET_EXCCODE(psupport->sup_exceptState[PGFAULTEXCEPT].cause);
@@ -96,7 +100,7 @@ void tlbExceptionHandler()
     switch (CAUSE_GET_EXCCODE(psupport->sup_exceptState[PGFAULTEXCEPT].cause)) {
         case EXC_MOD:
             /* this should never happen (pte are all rw) */
-            generalExceptionHandler();
+            generalExceptionHandler(psupport);
 			break;
 		case EXC_TLBL:
 		case EXC_TLBS:
@@ -122,7 +126,7 @@ HIDDEN unsigned int getFirstInFrame()
  * Support function for pageFaultHandler
  * it kicks out the given page frame, freeing it for use
  */
-HIDDEN inline void evictPage(unsigned int pfn, swap_t* spte)
+HIDDEN inline void evictPage(support_t* psupport, unsigned int pfn, swap_t* spte)
 {
     setSTATUS(getSTATUS() & (~IECON)); /* atomic on */
 
@@ -134,7 +138,27 @@ HIDDEN inline void evictPage(unsigned int pfn, swap_t* spte)
 
     setSTATUS(getSTATUS() | IECON); /* atomic off */
 
-    flashWrite(spte->sw_asid - 1, FLASHPOOLSTART + pfn * PAGESIZE, spte->sw_pageNo);
+    /*
+     * and the TLBs of the other processors, before the page is written out
+     * the wait (up to a quantum) is done without the swap pool, since its owner
+     * inherits the priority of every faulting process: meanwhile the frame
+     * is kept out of the FIFO and its page can't be faulted in again
+     */
+    unsigned int epoch = tlbShootdownStart();
+
+    if (!tlbShootdownDone(epoch)) {
+        frameEvicting[pfn] = 1;
+        SYSCALL(VERHOGEN, (memaddr) &swapPoolSem, SEM_MUTEX, 0);
+
+        do {
+            SYSCALL(YIELD, 0, 0, 0);
+        } while (!tlbShootdownDone(epoch));
+
+        SYSCALL(PASSEREN, (memaddr) &swapPoolSem, SEM_MUTEX, 0);
+        frameEvicting[pfn] = 0;
+    }
+
+    flashWrite(psupport, spte->sw_asid - 1, FLASHPOOLSTART + pfn * PAGESIZE, spte->sw_pageNo);
 }
 
 /*
@@ -142,7 +166,7 @@ HIDDEN inline void evictPage(unsigned int pfn, swap_t* spte)
  */
 HIDDEN void pageFaultHandler(support_t* psupport)
 {
-    SYSCALL(PASSEREN, (memaddr) &swapPoolSem, 0, 0);
+    SYSCALL(PASSEREN, (memaddr) &swapPoolSem, SEM_MUTEX, 0);
 
     /* get processor state at the time of the exception */
     state_t* processorState = &psupport->sup_exceptState[PGFAULTEXCEPT];
@@ -153,8 +177,32 @@ HIDDEN void pageFaultHandler(support_t* psupport)
     /* get the page table entry of the missed page */
     pteEntry_t* pte = &psupport->sup_privatePgTbl[vpn];
 
+    /*
+     * the page is already in: the TLB of this processor had a stale (not valid)
+     * translation, loaded while the process was running here before the page was in
+     */
+    if (pte->pte_entryLO & VALIDON) {
+        TLBCLR();
+        SYSCALL(VERHOGEN, (memaddr) &swapPoolSem, SEM_MUTEX, 0);
+        LDST(processorState);
+    }
+
+    /*
+     * the page is still in its frame, being written out by another pager
+     * (see evictPage): the fault is retried once it's on the flash
+     */
+    unsigned int frame = ENTRYLO_GET_PFN(pte->pte_entryLO);
+    if (frame < POOLSIZE && frameEvicting[frame] && swapPoolTable[frame].sw_pte == pte) {
+        SYSCALL(VERHOGEN, (memaddr) &swapPoolSem, SEM_MUTEX, 0);
+        SYSCALL(YIELD, 0, 0, 0);
+        LDST(processorState);
+    }
+
     /* find a physical frame for the soon-to-be-faulted-in page to reside within */
-    unsigned int pfn = getFirstInFrame();
+    unsigned int pfn;
+    do {
+        pfn = getFirstInFrame();
+    } while (frameEvicting[pfn]);
 
     /* if no free frame is available */
     if (
@@ -162,10 +210,10 @@ HIDDEN void pageFaultHandler(support_t* psupport)
         swapPoolTable[pfn].sw_pte->pte_entryLO & VALIDON
     ) {
         /* run page-replacement algorithm on the found pfn */
-        evictPage(pfn, &swapPoolTable[pfn]);
+        evictPage(psupport, pfn, &swapPoolTable[pfn]);
     }
 
-    flashRead(psupport->sup_asid - 1, FLASHPOOLSTART + pfn * PAGESIZE, vpn);
+    flashRead(psupport, psupport->sup_asid - 1, FLASHPOOLSTART + pfn * PAGESIZE, vpn);
 
     /* update the swap pool table entry of the new occupied frame */
     swapPoolTable[pfn].sw_asid = psupport->sup_asid;
@@ -183,7 +231,7 @@ HIDDEN void pageFaultHandler(support_t* psupport)
 
     setSTATUS(getSTATUS() | IECON); /* atomic off */
 
-    SYSCALL(VERHOGEN, (memaddr) &swapPoolSem, 0, 0);
+    SYSCALL(VERHOGEN, (memaddr) &swapPoolSem, SEM_MUTEX, 0);
 
 	/* return control and let the hardware retry the instruction */
     LDST(processorState);
@@ -194,12 +242,12 @@ HIDDEN void pageFaultHandler(support_t* psupport)
 /*
  * Initiates a R/W operation on the specified flash device
  */
-HIDDEN void flashInit(unsigned int flashNo, devregf_t command, devregf_t data0)
+HIDDEN void flashInit(support_t* psupport, unsigned int flashNo, devregf_t command, devregf_t data0)
 {
     dtpreg_t* flashReg = (dtpreg_t*) DEV_REG_ADDR(FLASHINT, flashNo);
     devregf_t status;
 
-    SYSCALL(PASSEREN, (memaddr) &flashSems[flashNo], 0, 0);
+    SYSCALL(PASSEREN, (memaddr) &flashSems[flashNo], SEM_MUTEX, 0);
 
     setSTATUS(getSTATUS() & (~IECON)); /* atomic on */
 
@@ -209,18 +257,18 @@ HIDDEN void flashInit(unsigned int flashNo, devregf_t command, devregf_t data0)
     setSTATUS(getSTATUS() | IECON); /* atomic off */
 
     if (status != READY) {
-        generalExceptionHandler();
+        generalExceptionHandler(psupport);
     }
 
-    SYSCALL(VERHOGEN, (memaddr) &flashSems[flashNo], 0, 0);
+    SYSCALL(VERHOGEN, (memaddr) &flashSems[flashNo], SEM_MUTEX, 0);
 }
 
-HIDDEN void flashRead(unsigned int flashNo, memaddr srcAddr, unsigned int blockNumber)
+HIDDEN void flashRead(support_t* psupport, unsigned int flashNo, memaddr srcAddr, unsigned int blockNumber)
 {
-    flashInit(flashNo, FLASHREAD | blockNumber << BYTELENGTH, srcAddr);
+    flashInit(psupport, flashNo, FLASHREAD | blockNumber << BYTELENGTH, srcAddr);
 }
 
-HIDDEN void flashWrite(unsigned int flashNo, memaddr destAddr, unsigned int blockNumber)
+HIDDEN void flashWrite(support_t* psupport, unsigned int flashNo, memaddr destAddr, unsigned int blockNumber)
 {
-    flashInit(flashNo, FLASHWRITE | blockNumber << BYTELENGTH, destAddr);
+    flashInit(psupport, flashNo, FLASHWRITE | blockNumber << BYTELENGTH, destAddr);
 }
\ No newline at end of file
@@ -2,47 +2,147 @@
 #include "pandos_types.h"
 
 /*
- * Naive implementation of memcpy
+ * Kernel runtime library: memory primitives
+ * the copies and fills go a word at a time (unrolled, 4 words per iteration)
+ * when the addresses are word aligned, as the kernel structures are,
+ * and a byte at a time otherwise (MIPS has no unaligned word access)
+ * the compiler must not turn their loops back into calls to themselves
  */
-void* memcpy(void* dest, const void* src, size_t n)
+#define NO_LIBCALL __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+/* the address is word aligned */
+#define WORD_ALIGNED(p) ((((memaddr) (p)) & (WORDLEN - 1)) == 0)
+
+NO_LIBCALL void* memcpy(void* dest, const void* src, size_t n)
 {
-    for (size_t i = 0; i < n; i++) {
-        ((unsigned char*) dest)[i] = ((unsigned char*) src)[i];
+    unsigned char* d = dest;
+    const unsigned char* s = src;
+
+    if (WORD_ALIGNED(d) && WORD_ALIGNED(s)) {
+        unsigned int* dw = (unsigned int*) d;
+        const unsigned int* sw = (const unsigned int*) s;
+
+        for (; n >= 4 * WORDLEN; n -= 4 * WORDLEN, dw += 4, sw += 4) {
+            dw[0] = sw[0];
+            dw[1] = sw[1];
+            dw[2] = sw[2];
+            dw[3] = sw[3];
+        }
+        for (; n >= WORDLEN; n -= WORDLEN) {
+            *dw++ = *sw++;
+        }
+
+        d = (unsigned char*) dw;
+        s = (const unsigned char*) sw;
+    }
+
+    while (n-- > 0) {
+        *d++ = *s++;
     }
 
     return dest;
 }
 
+NO_LIBCALL void* memset(void* dest, int c, size_t n)
+{
+    unsigned char* d = dest;
+    unsigned char b = (unsigned char) c;
+
+    /* up to the first aligned word */
+    for (; n > 0 && !WORD_ALIGNED(d); --n) {
+        *d++ = b;
+    }
+
+    unsigned int* dw = (unsigned int*) d;
+    unsigned int w = b * 0x01010101U;
+
+    for (; n >= 4 * WORDLEN; n -= 4 * WORDLEN, dw += 4) {
+        dw[0] = w;
+        dw[1] = w;
+        dw[2] = w;
+        dw[3] = w;
+    }
+    for (; n >= WORDLEN; n -= WORDLEN) {
+        *dw++ = w;
+    }
+
+    d = (unsigned char*) dw;
+    while (n-- > 0) {
+        *d++ = b;
+    }
+
+    return dest;
+}
+
+/* a processor state is copied 5 words at a time (35 words) */
+_Static_assert(sizeof(state_t) % (5 * WORDLEN) == 0, "state_t is not a multiple of 5 words");
+
 /*
- * Most significant bit (naive)
+ * Copy a processor state (save/restore of the process states)
+ * state_t is made only of words, and it's word aligned
+ */
+NO_LIBCALL void stateCopy(state_t* dest, const state_t* src)
+{
+    unsigned int* d = (unsigned int*) dest;
+    const unsigned int* s = (const unsigned int*) src;
+
+    for (size_t i = 0; i < sizeof(state_t) / WORDLEN; i += 5) {
+        d[i] = s[i];
+        d[i + 1] = s[i + 1];
+        d[i + 2] = s[i + 2];
+        d[i + 3] = s[i + 3];
+        d[i + 4] = s[i + 4];
+    }
+}
+
+/*
+ * Clear a processor state
+ * state_t is word aligned, so memset clears it a word at a time
+ */
+void stateClear(state_t* s)
+{
+    memset(s, 0, sizeof(state_t));
+}
+
+/*
+ * Bit scanning in constant time (no loops, no branches) with de Bruijn sequences:
+ * a 32 bit de Bruijn sequence has every 5 bit pattern exactly once as its top bits
+ * when shifted left, so multiplying it by a power of 2 (1 << pos) and taking
+ * the top 5 bits gives a distinct index for each pos, mapped back by a table
+ */
+
+/* de Bruijn sequence B(2, 5) and bit position of each of its 5 bit windows */
+#define DEBRUIJN32 0x077CB531U
+HIDDEN const unsigned char debruijnPos[32] = {
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+
+/*
+ * Most significant bit
  * Returns the position of the most significant set bit (1 bit)
  * if v is 0, the return is undefined
  */
 unsigned int msb(unsigned int v)
 {
-    unsigned int pos = 0;
-    while (v >>= 1) {
-        ++pos;
-    }
+    /* set all the bits below the most significant one, then keep just that one */
+    v |= v >> 1;
+    v |= v >> 2;
+    v |= v >> 4;
+    v |= v >> 8;
+    v |= v >> 16;
+    v ^= v >> 1;
 
-    return pos;
+    return debruijnPos[(v * DEBRUIJN32) >> 27];
 }
 
 /*
- * Less significant bit (naive)
+ * Less significant bit
  * Returns the position of the less significant set bit (1 bit)
- * if v is 0, the return is undefined
+ * if v is 0, the return is 0
  */
 unsigned int lsb(unsigned int v)
 {
-    unsigned int pos = 0;
-
-    if (v != 0) {
-        while (!(v & 0x1)) {
-            v >>= 1;
-            ++pos;
-        }
-    }
-
-    return pos;
+    /* v & -v keeps just the less significant set bit (0 for v = 0, position 0) */
+    return debruijnPos[((v & -v) * DEBRUIJN32) >> 27];
 }